@@ -0,0 +1,341 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "jitter_buffer.h"
+#include "bench_trace.h"
+
+static const char *TAG = "JITTER_BUFFER_BENCH";
+
+#define BENCH_FRAMES       3000   /* 每条 trace 60 s */
+#define BENCH_INTERVAL_MS  20
+#define BENCH_DRAIN_TICKS  64     /* trace 结束后继续读的拍数，把缓冲读空 */
+#define BENCH_PCM_FRAME    640    /* 16 kHz 单声道 20 ms */
+#define BENCH_HDR_MIN_LEN  40     /* with_header 变长帧长度范围（Opus 典型包长） */
+#define BENCH_HDR_MAX_LEN  200
+#define BENCH_HIGH_WATER   5
+#define BENCH_LOW_WATER    2
+#define BENCH_DEPTH_FRAMES 12     /* 环形缓冲可容纳的帧数，Wi-Fi 突发时会溢出 */
+#define BENCH_MICRO_OPS    200000
+
+/* payload 前 4 字节为大端序号，随后 8 字节为到达时间，用于在输出端计算延迟 */
+#define BENCH_PAYLOAD_HDR  12
+
+typedef enum {
+    BENCH_MODE_PCM,     /* 无头固定帧长 FIFO */
+    BENCH_MODE_HEADER,  /* with_header 变长帧 FIFO */
+    BENCH_MODE_PACKET,  /* 包模式按序号重排 */
+    BENCH_MODE_MAX,
+} bench_mode_t;
+
+static const char *s_mode_names[BENCH_MODE_MAX] = { "pcm", "with_header", "packet" };
+
+typedef struct {
+    int64_t *v;
+    size_t   n;
+    size_t   cap;
+} bench_samples_t;
+
+static int64_t s_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool s_samples_init(bench_samples_t *s, size_t cap)
+{
+    s->v = (int64_t *)malloc(cap * sizeof(int64_t));
+    s->n = 0;
+    s->cap = cap;
+    return s->v != NULL;
+}
+
+static inline void s_samples_push(bench_samples_t *s, int64_t v)
+{
+    if (s->n < s->cap) {
+        s->v[s->n++] = v;
+    }
+}
+
+static int s_int64_cmp(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* 排序后打印 p50/p90/p99/max，div 为单位换算的除数 */
+static void s_samples_print(const char *name, bench_samples_t *s, int64_t div, const char *unit)
+{
+    if (s->n == 0) {
+        printf("  %-22s n=0\n", name);
+        return;
+    }
+    qsort(s->v, s->n, sizeof(int64_t), s_int64_cmp);
+    printf("  %-22s n=%-6zu p50=%-7lld p90=%-7lld p99=%-7lld max=%-7lld %s\n", name, s->n,
+           (long long)(s->v[s->n * 50 / 100] / div), (long long)(s->v[s->n * 90 / 100] / div),
+           (long long)(s->v[s->n * 99 / 100] / div), (long long)(s->v[s->n - 1] / div), unit);
+}
+
+static void s_samples_free(bench_samples_t *s)
+{
+    free(s->v);
+    s->v = NULL;
+    s->n = s->cap = 0;
+}
+
+/* 水位优先取环境变量（用于对录制 trace 调参），其次取录制时的配置，最后取默认值 */
+static uint32_t s_water(const char *env, uint32_t recorded, uint32_t def)
+{
+    const char *v = getenv(env);
+    if (v != NULL && atoi(v) > 0) {
+        return (uint32_t)atoi(v);
+    }
+    return recorded > 0 ? recorded : def;
+}
+
+/* trace 为 NULL 时（微基准）使用默认帧间隔与水位 */
+static jitter_buffer_config_t s_make_config(bench_mode_t mode, const bench_trace_t *trace)
+{
+    jitter_buffer_config_t config = DEFAULT_JITTER_BUFFER_CONFIG();
+    /* 拉模式：不创建播放任务，由 trace 回放按虚拟时间调用 jitter_buffer_read()，结果与实际耗时无关、可复现 */
+    config.clock_source = JITTER_CLOCK_PULL;
+    config.audio_format_id = AUDIO_FORMAT_ID_PCM;
+    config.frame_interval = trace != NULL ? trace->interval_ms : BENCH_INTERVAL_MS;
+    config.high_water = s_water("JITTER_BENCH_HIGH_WATER", trace != NULL ? trace->high_water : 0, BENCH_HIGH_WATER);
+    config.low_water = s_water("JITTER_BENCH_LOW_WATER", trace != NULL ? trace->low_water : 0, BENCH_LOW_WATER);
+    /* adaptive_delay 保持关闭：其抖动估计使用 esp_timer 实时时间，与虚拟时间回放不一致 */
+    switch (mode) {
+    case BENCH_MODE_PCM:
+        config.frame_size = BENCH_PCM_FRAME;
+        config.buffer_size = BENCH_DEPTH_FRAMES * BENCH_PCM_FRAME;
+        break;
+    case BENCH_MODE_HEADER:
+        config.with_header = true;
+        config.frame_size = BENCH_HDR_MAX_LEN;
+        config.buffer_size = BENCH_DEPTH_FRAMES * (BENCH_HDR_MIN_LEN + BENCH_HDR_MAX_LEN) / 2;
+        break;
+    default:
+        config.frame_size = BENCH_PCM_FRAME;
+        config.packet_slots = BENCH_DEPTH_FRAMES * 2;
+        break;
+    }
+    return config;
+}
+
+static void s_fill_payload(uint8_t *buf, size_t len, uint32_t seq, int64_t arrival_us)
+{
+    memset(buf, 0x55, len);
+    buf[0] = (uint8_t)(seq >> 24);
+    buf[1] = (uint8_t)(seq >> 16);
+    buf[2] = (uint8_t)(seq >> 8);
+    buf[3] = (uint8_t)seq;
+    memcpy(buf + 4, &arrival_us, sizeof(arrival_us));
+}
+
+static void s_run_trace(const bench_trace_t *trace, bench_mode_t mode)
+{
+    jitter_buffer_config_t config = s_make_config(mode, trace);
+    jitter_buffer_handle_t h = jitter_buffer_create(&config);
+    if (h == NULL) {
+        ESP_LOGE(TAG, "create failed: %s/%s", trace->name, s_mode_names[mode]);
+        return;
+    }
+    jitter_buffer_start(h);
+
+    size_t ticks = trace->frames + BENCH_DRAIN_TICKS;
+    bench_samples_t write_ns = { 0 }, read_ns = { 0 }, e2e_us = { 0 }, buf_us = { 0 };
+    if (!s_samples_init(&write_ns, trace->count) || !s_samples_init(&read_ns, ticks) ||
+        !s_samples_init(&e2e_us, ticks) || !s_samples_init(&buf_us, ticks)) {
+        ESP_LOGE(TAG, "no memory for samples");
+        goto exit;
+    }
+
+    uint8_t in[BENCH_PCM_FRAME];
+    uint8_t out[BENCH_PCM_FRAME];
+    int64_t interval_us = (int64_t)trace->interval_ms * 1000;
+    size_t next = 0;
+    uint32_t played = 0;
+    uint32_t reordered = 0;
+    uint32_t write_err = 0;
+    int64_t last_seq = -1;
+    for (size_t k = 0; k < ticks; k++) {
+        int64_t now_us = (int64_t)k * interval_us;
+        /* 先写入本拍之前到达的所有包，再读一帧 */
+        while (next < trace->count && trace->packets[next].arrival_us <= now_us) {
+            const bench_packet_t *p = &trace->packets[next++];
+            size_t len = mode == BENCH_MODE_HEADER ? p->len : BENCH_PCM_FRAME;
+            if (len < BENCH_PAYLOAD_HDR) {
+                len = BENCH_PAYLOAD_HDR;
+            } else if (len > sizeof(in)) {
+                len = sizeof(in);
+            }
+            s_fill_payload(in, len, p->seq, p->arrival_us);
+            esp_err_t ret;
+            int64_t t0 = s_now_ns();
+            if (mode == BENCH_MODE_PACKET) {
+                ret = jitter_buffer_write_packet(h, p->seq, (uint32_t)p->seq * BENCH_PCM_FRAME / 2, in, len);
+            } else {
+                ret = jitter_buffer_write(h, in, len);
+            }
+            s_samples_push(&write_ns, s_now_ns() - t0);
+            if (ret != ESP_OK) {
+                write_err++;
+            }
+        }
+
+        size_t out_len = 0;
+        int64_t t0 = s_now_ns();
+        esp_err_t ret = jitter_buffer_read(h, out, sizeof(out), &out_len);
+        s_samples_push(&read_ns, s_now_ns() - t0);
+        if (ret != ESP_OK || out_len < BENCH_PAYLOAD_HDR) {
+            continue;
+        }
+        uint32_t seq = ((uint32_t)out[0] << 24) | ((uint32_t)out[1] << 16) | ((uint32_t)out[2] << 8) | out[3];
+        int64_t arrival_us;
+        memcpy(&arrival_us, out + 4, sizeof(arrival_us));
+        played++;
+        if ((int64_t)seq < last_seq) {
+            reordered++;
+        }
+        last_seq = seq;
+        s_samples_push(&e2e_us, now_us - (int64_t)seq * interval_us);
+        s_samples_push(&buf_us, now_us - arrival_us);
+    }
+
+    jitter_buffer_stats_t st;
+    jitter_buffer_get_stats(h, &st);
+    printf("[%s / %s] high_water=%" PRIu32 " low_water=%" PRIu32 " sent=%" PRIu32 " arrived=%zu played=%" PRIu32
+           " out_of_order=%" PRIu32 " write_err=%" PRIu32 "\n", trace->name, s_mode_names[mode], config.high_water,
+           config.low_water, trace->frames, trace->count, played, reordered, write_err);
+    printf("  underrun=%" PRIu32 " overrun=%" PRIu32 " drop_oldest=%" PRIu32 " discarded=%" PRIu32
+           " lost=%" PRIu32 " late=%" PRIu32 " dup=%" PRIu32 " depth_max=%" PRIu32 "\n",
+           st.underrun_count, st.overrun_count, st.overrun_drop_oldest, st.discarded_frames,
+           st.lost_packets, st.late_packets, st.duplicate_packets, st.depth_max);
+    /* 无竞争时单次调用耗时即锁持有时间的上界 */
+    s_samples_print("write call", &write_ns, 1, "ns");
+    s_samples_print("read call", &read_ns, 1, "ns");
+    s_samples_print("latency end-to-end", &e2e_us, 1000, "ms");
+    s_samples_print("latency in buffer", &buf_us, 1000, "ms");
+
+exit:
+    s_samples_free(&write_ns);
+    s_samples_free(&read_ns);
+    s_samples_free(&e2e_us);
+    s_samples_free(&buf_us);
+    jitter_buffer_stop(h);
+    jitter_buffer_destroy(h);
+}
+
+/* 稳态吞吐：预先填到 high_water 使状态进入 PLAYING，之后每写一帧读一帧，深度保持不变 */
+static void s_bench_pairs(bench_mode_t mode)
+{
+    jitter_buffer_config_t config = s_make_config(mode, NULL);
+    jitter_buffer_handle_t h = jitter_buffer_create(&config);
+    if (h == NULL) {
+        return;
+    }
+    jitter_buffer_start(h);
+    uint8_t buf[BENCH_PCM_FRAME];
+    size_t len = mode == BENCH_MODE_HEADER ? BENCH_HDR_MAX_LEN * 3 / 4 : BENCH_PCM_FRAME;
+    s_fill_payload(buf, len, 0, 0);
+    for (int i = 0; i < BENCH_HIGH_WATER; i++) {
+        jitter_buffer_write(h, buf, len);
+    }
+    size_t out_len;
+    uint32_t miss = 0;
+    int64_t t0 = s_now_ns();
+    for (int i = 0; i < BENCH_MICRO_OPS; i++) {
+        jitter_buffer_write(h, buf, len);
+        if (jitter_buffer_read(h, buf, sizeof(buf), &out_len) != ESP_OK) {
+            miss++;
+        }
+    }
+    int64_t ns = s_now_ns() - t0;
+    printf("  %-12s write+read pair: %6.1f ns (%zu-byte frames, %" PRIu32 " empty reads)\n", s_mode_names[mode],
+           (double)ns / BENCH_MICRO_OPS, len, miss);
+    jitter_buffer_stop(h);
+    jitter_buffer_destroy(h);
+}
+
+/* 溢出路径：不读，缓冲满后每次写入都要按整帧丢弃队头 */
+static void s_bench_overrun(bench_mode_t mode)
+{
+    jitter_buffer_config_t config = s_make_config(mode, NULL);
+    jitter_buffer_handle_t h = jitter_buffer_create(&config);
+    if (h == NULL) {
+        return;
+    }
+    uint8_t buf[BENCH_PCM_FRAME];
+    size_t len = mode == BENCH_MODE_HEADER ? BENCH_HDR_MAX_LEN * 3 / 4 : BENCH_PCM_FRAME;
+    s_fill_payload(buf, len, 0, 0);
+    for (int i = 0; i < BENCH_DEPTH_FRAMES * 2; i++) {
+        jitter_buffer_write(h, buf, len);
+    }
+    int64_t t0 = s_now_ns();
+    for (int i = 0; i < BENCH_MICRO_OPS; i++) {
+        jitter_buffer_write(h, buf, len);
+    }
+    int64_t ns = s_now_ns() - t0;
+    jitter_buffer_stats_t st;
+    jitter_buffer_get_stats(h, &st);
+    printf("  %-12s overrun write:   %6.1f ns (drop_oldest=%" PRIu32 ")\n", s_mode_names[mode],
+           (double)ns / BENCH_MICRO_OPS, st.overrun_drop_oldest);
+    jitter_buffer_destroy(h);
+}
+
+void app_main(void)
+{
+    /* 溢出与欠载在回放中是预期行为，关闭组件的告警日志以免影响计时 */
+    esp_log_level_set("JITTER_BUFFER", ESP_LOG_ERROR);
+
+    const char *path = getenv("JITTER_BENCH_TRACE");
+    if (path != NULL) {
+        bench_trace_t trace;
+        esp_err_t ret = bench_trace_load(&trace, path);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "load %s failed: %s", path, esp_err_to_name(ret));
+        } else {
+            if (trace.field_frames + trace.field_empty > 0) {
+                /* 录制时的实际输出，与下面的回放结果对照 */
+                printf("[%s / field] played=%" PRIu32 " empty_ticks=%" PRIu32 "\n", trace.name, trace.field_frames,
+                       trace.field_empty);
+            }
+            for (int mode = 0; mode < BENCH_MODE_MAX; mode++) {
+                s_run_trace(&trace, (bench_mode_t)mode);
+            }
+            bench_trace_free(&trace);
+        }
+    } else {
+        for (int type = 0; type < BENCH_TRACE_MAX; type++) {
+            bench_trace_t trace;
+            if (bench_trace_generate(&trace, (bench_trace_type_t)type, BENCH_FRAMES, BENCH_INTERVAL_MS,
+                                     BENCH_HDR_MIN_LEN, BENCH_HDR_MAX_LEN) != ESP_OK) {
+                continue;
+            }
+            for (int mode = 0; mode < BENCH_MODE_MAX; mode++) {
+                s_run_trace(&trace, (bench_mode_t)mode);
+            }
+            bench_trace_free(&trace);
+        }
+    }
+
+    printf("[micro] %d ops\n", BENCH_MICRO_OPS);
+    s_bench_pairs(BENCH_MODE_PCM);
+    s_bench_pairs(BENCH_MODE_HEADER);
+    s_bench_overrun(BENCH_MODE_PCM);
+    s_bench_overrun(BENCH_MODE_HEADER);
+
+    fflush(stdout);
+    /* linux 目标下 app_main 返回后进程不会退出 */
+    exit(0);
+}
@@ -0,0 +1,289 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jitter_buffer.h"
+#include "bench_trace.h"
+
+static const char *s_trace_names[BENCH_TRACE_MAX] = { "steady", "wifi_burst", "reorder", "loss" };
+
+/* 固定种子的 xorshift32，保证每次运行的 trace 相同 */
+static uint32_t s_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static inline uint32_t s_rand_range(uint32_t *state, uint32_t lo, uint32_t hi)
+{
+    return lo + s_rand(state) % (hi - lo + 1);
+}
+
+static int s_packet_cmp(const void *a, const void *b)
+{
+    const bench_packet_t *pa = (const bench_packet_t *)a;
+    const bench_packet_t *pb = (const bench_packet_t *)b;
+    if (pa->arrival_us != pb->arrival_us) {
+        return pa->arrival_us < pb->arrival_us ? -1 : 1;
+    }
+    /* 同时到达时保持发送顺序 */
+    return (int)pa->seq - (int)pb->seq;
+}
+
+esp_err_t bench_trace_generate(bench_trace_t *trace, bench_trace_type_t type, uint32_t frames, uint32_t interval_ms,
+                               uint16_t min_len, uint16_t max_len)
+{
+    if (trace == NULL || type >= BENCH_TRACE_MAX || frames == 0 || frames > UINT16_MAX || min_len > max_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(trace, 0, sizeof(*trace));
+    trace->packets = (bench_packet_t *)calloc(frames, sizeof(bench_packet_t));
+    if (trace->packets == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(trace->name, sizeof(trace->name), "%s", s_trace_names[type]);
+    trace->frames = frames;
+    trace->interval_ms = interval_ms;
+
+    uint32_t rng = 0x2545F491u + (uint32_t)type;
+    int64_t interval_us = (int64_t)interval_ms * 1000;
+    int64_t stall_start = 0;
+    int64_t stall_end = 0;
+    uint32_t loss_burst = 0;
+    for (uint32_t seq = 0; seq < frames; seq++) {
+        int64_t send_us = (int64_t)seq * interval_us;
+        int64_t arrival_us = send_us + s_rand_range(&rng, 5000, 9000);
+        switch (type) {
+        case BENCH_TRACE_WIFI_BURST:
+            if (send_us >= stall_end && s_rand(&rng) % (2000000 / interval_us) == 0) {
+                stall_start = send_us;
+                stall_end = send_us + s_rand_range(&rng, 150000, 300000);
+            }
+            if (send_us >= stall_start && send_us < stall_end) {
+                /* 卡顿期间发送的包在卡顿结束时以 300 us 间隔连续到达 */
+                arrival_us = stall_end + (send_us - stall_start) / interval_us * 300;
+            }
+            break;
+        case BENCH_TRACE_REORDER:
+            if (s_rand(&rng) % 100 < 5) {
+                arrival_us += (int64_t)s_rand_range(&rng, 1, 3) * interval_us;
+            }
+            break;
+        case BENCH_TRACE_LOSS:
+            arrival_us = send_us + s_rand_range(&rng, 5000, 11000);
+            if (loss_burst == 0 && s_rand(&rng) % 100 == 0) {
+                loss_burst = s_rand_range(&rng, 2, 5);
+            }
+            if (loss_burst > 0) {
+                loss_burst--;
+                continue;
+            }
+            if (s_rand(&rng) % 100 < 3) {
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+        bench_packet_t *p = &trace->packets[trace->count++];
+        p->arrival_us = arrival_us;
+        p->seq = (uint16_t)seq;
+        p->len = (uint16_t)s_rand_range(&rng, min_len, max_len);
+    }
+    qsort(trace->packets, trace->count, sizeof(bench_packet_t), s_packet_cmp);
+    return ESP_OK;
+}
+
+/* 解析 jitter_buffer_trace_dump() 的二进制流：写入记录还原为到达序列，输出记录只计数作为现场结果对照 */
+static esp_err_t s_load_dump(bench_trace_t *trace, const uint8_t *data, size_t len)
+{
+    jitter_buffer_trace_header_t hdr;
+    if (len < sizeof(hdr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+    if (memcmp(hdr.magic, JITTER_TRACE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != JITTER_TRACE_VERSION ||
+        hdr.entry_size != sizeof(jitter_buffer_trace_entry_t)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    size_t n = (len - sizeof(hdr)) / sizeof(jitter_buffer_trace_entry_t);
+    if (n > hdr.count) {
+        n = hdr.count;
+    }
+    trace->packets = (bench_packet_t *)calloc(n > 0 ? n : 1, sizeof(bench_packet_t));
+    if (trace->packets == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    trace->interval_ms = hdr.frame_interval;
+    trace->high_water = hdr.high_water;
+    trace->low_water = hdr.low_water;
+
+    /* time_us 只有低 32 位，按相邻差值展开；以第一条写入为时间与序号零点 */
+    int64_t t = 0;
+    int64_t base = -1;
+    uint32_t prev = 0;
+    uint16_t seq0 = 0;
+    for (size_t i = 0; i < n; i++) {
+        jitter_buffer_trace_entry_t e;
+        memcpy(&e, data + sizeof(hdr) + i * sizeof(e), sizeof(e));
+        if (i > 0) {
+            t += (uint32_t)(e.time_us - prev);
+        }
+        prev = e.time_us;
+        if (e.event == JITTER_TRACE_WRITE || e.event == JITTER_TRACE_WRITE_PACKET) {
+            if (base < 0) {
+                base = t;
+                seq0 = e.seq;
+            }
+            bench_packet_t *p = &trace->packets[trace->count++];
+            p->arrival_us = t - base;
+            p->seq = (uint16_t)(e.seq - seq0);
+            p->len = e.len;
+            if ((uint32_t)p->seq + 1 > trace->frames) {
+                trace->frames = (uint32_t)p->seq + 1;
+            }
+        } else if (e.event == JITTER_TRACE_OUT_FRAME) {
+            trace->field_frames++;
+        } else {
+            trace->field_empty++;
+        }
+    }
+    return trace->count > 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+static inline int s_hex_val(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* 从串口日志中取出 "jbtr:" 行并解码，原地写回 text，返回字节数 */
+static size_t s_decode_hex_lines(char *text)
+{
+    uint8_t *dst = (uint8_t *)text;
+    size_t n = 0;
+    for (char *line = strstr(text, "jbtr:"); line != NULL; line = strstr(line, "jbtr:")) {
+        line += 5;
+        while (s_hex_val(line[0]) >= 0 && s_hex_val(line[1]) >= 0) {
+            dst[n++] = (uint8_t)(s_hex_val(line[0]) << 4 | s_hex_val(line[1]));
+            line += 2;
+        }
+    }
+    return n;
+}
+
+static esp_err_t s_load_text(bench_trace_t *trace, char *text)
+{
+    size_t cap = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save)) {
+        long long arrival;
+        unsigned seq, len;
+        if (line[0] == '#' || sscanf(line, "%lld %u %u", &arrival, &seq, &len) != 3) {
+            continue;
+        }
+        if (trace->count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            bench_packet_t *p = (bench_packet_t *)realloc(trace->packets, cap * sizeof(bench_packet_t));
+            if (p == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+            trace->packets = p;
+        }
+        trace->packets[trace->count].arrival_us = arrival;
+        trace->packets[trace->count].seq = (uint16_t)seq;
+        trace->packets[trace->count].len = (uint16_t)len;
+        trace->count++;
+        if (seq + 1 > trace->frames) {
+            trace->frames = seq + 1;
+        }
+    }
+    return trace->count > 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t bench_trace_load(bench_trace_t *trace, const char *path)
+{
+    if (trace == NULL || path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(trace, 0, sizeof(*trace));
+    const char *base = strrchr(path, '/');
+    snprintf(trace->name, sizeof(trace->name), "%s", base ? base + 1 : path);
+
+    /* 整个文件读入内存，末尾补 0 便于按文本处理 */
+    size_t cap = 4096;
+    size_t len = 0;
+    char *data = (char *)malloc(cap + 1);
+    while (data != NULL) {
+        len += fread(data + len, 1, cap - len, f);
+        if (len < cap) {
+            break;
+        }
+        cap *= 2;
+        char *p = (char *)realloc(data, cap + 1);
+        if (p == NULL) {
+            free(data);
+        }
+        data = p;
+    }
+    fclose(f);
+    if (data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    data[len] = '\0';
+
+    esp_err_t ret;
+    if (len >= 4 && memcmp(data, JITTER_TRACE_MAGIC, 4) == 0) {
+        ret = s_load_dump(trace, (const uint8_t *)data, len);
+    } else if (strstr(data, "jbtr:") != NULL) {
+        ret = s_load_dump(trace, (const uint8_t *)data, s_decode_hex_lines(data));
+    } else {
+        ret = s_load_text(trace, data);
+    }
+    free(data);
+    if (ret != ESP_OK) {
+        bench_trace_free(trace);
+        return ret;
+    }
+    if (trace->interval_ms == 0) {
+        trace->interval_ms = BENCH_TRACE_DEFAULT_INTERVAL_MS;
+    }
+    qsort(trace->packets, trace->count, sizeof(bench_packet_t), s_packet_cmp);
+    /* 序号不足以覆盖整段时长时（序号回绕或丢包），按最后到达时间补足回放拍数 */
+    uint32_t span = (uint32_t)(trace->packets[trace->count - 1].arrival_us / ((int64_t)trace->interval_ms * 1000)) + 1;
+    if (span > trace->frames) {
+        trace->frames = span;
+    }
+    return ESP_OK;
+}
+
+void bench_trace_free(bench_trace_t *trace)
+{
+    if (trace == NULL) {
+        return;
+    }
+    free(trace->packets);
+    trace->packets = NULL;
+    trace->count = 0;
+}
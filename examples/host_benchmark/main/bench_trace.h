@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_TRACE_DEFAULT_INTERVAL_MS 20  /**< Frame interval assumed for text traces */
+
+/** One packet of an arrival trace, sorted by arrival_us */
+typedef struct {
+    int64_t  arrival_us;  /**< Arrival time relative to the first packet's send time */
+    uint16_t seq;         /**< Sequence number, send time is seq * frame_interval */
+    uint16_t len;         /**< Payload length */
+} bench_packet_t;
+
+typedef struct {
+    char            name[32];
+    bench_packet_t *packets;
+    size_t          count;
+    uint32_t        frames;        /**< Frames sent, including lost ones */
+    uint32_t        interval_ms;   /**< Frame interval of the trace */
+    uint32_t        high_water;    /**< Recorded trace: water marks of the recording buffer, 0 otherwise */
+    uint32_t        low_water;
+    uint32_t        field_frames;  /**< Recorded trace: playout ticks that output a buffered frame */
+    uint32_t        field_empty;   /**< Recorded trace: playout ticks that concealed, output silence or nothing */
+} bench_trace_t;
+
+/** Built-in synthetic arrival patterns */
+typedef enum {
+    BENCH_TRACE_STEADY,      /**< 5-9 ms network delay, no loss */
+    BENCH_TRACE_WIFI_BURST,  /**< 150-300 ms stalls every ~2 s, then the queued packets arrive back to back */
+    BENCH_TRACE_REORDER,     /**< 5% of packets delayed by 1-3 frames so they arrive out of order */
+    BENCH_TRACE_LOSS,        /**< 3% random loss plus bursts of 2-5 lost packets, 0-6 ms jitter */
+    BENCH_TRACE_MAX,
+} bench_trace_type_t;
+
+/* Breif: Generate a deterministic synthetic trace
+ *
+ * frames       Number of frames sent
+ * interval_ms  Frame interval
+ * min_len/max_len Payload length range; equal values give fixed-size frames
+ */
+esp_err_t bench_trace_generate(bench_trace_t *trace, bench_trace_type_t type, uint32_t frames, uint32_t interval_ms,
+                               uint16_t min_len, uint16_t max_len);
+
+/* Breif: Load a recorded trace
+ *
+ * Accepts a jitter_buffer_trace_dump() stream, raw binary or the "jbtr:" hex lines (other lines, e.g. the rest of a
+ * monitor log, are skipped), or a text file with one packet per line: "<arrival_us> <seq> <len>", lines starting with
+ * '#' are ignored. Packets are sorted by arrival time after loading.
+ */
+esp_err_t bench_trace_load(bench_trace_t *trace, const char *path);
+
+void bench_trace_free(bench_trace_t *trace);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,12 +12,13 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "jitter_buffer.h"
+#include "jitter_buffer_pool.h"
 
 static jitter_buffer_handle_t jitter_buffer_handle;
 
 static const char *TAG = "JITTER_BUFFER_EXAMPLE";
 
-/* 测试 case：0=创建/销毁泄漏, 1=reset, 2=start/stop, 3=正常跑, 其他=依次跑 0,1,2 再跑 3 */
+/* 测试 case：0=创建/销毁泄漏, 1=reset, 2=start/stop, 3=正常跑, 4=实例池复用, 其他=依次跑 0,1,2,4 再跑 3 */
 #ifndef JITTER_EXAMPLE_CASE
 #define JITTER_EXAMPLE_CASE 3
 #endif
@@ -152,6 +153,41 @@ static void run_case_create_destroy_leak(void)
     }
 }
 
+/** Case 4: 实例池复用，每次会话 acquire -> start -> 写 -> release，不再分配与释放 */
+static void run_case_pool(void)
+{
+    ESP_LOGI(TAG, "========== Case 4: pool reuse test (loops=%d) ==========", LEAK_TEST_LOOPS);
+
+    jitter_buffer_config_t config = DEFAULT_JITTER_BUFFER_CONFIG();
+    config.on_output_data = on_output_data_noop;
+    config.buffer_size = 10 * 1024;
+    config.with_header = true;
+
+    jitter_buffer_pool_handle_t pool = jitter_buffer_pool_create(&config, 2);
+    if (pool == NULL) {
+        ESP_LOGE(TAG, "pool create failed");
+        return;
+    }
+    uint8_t frame[64] = { 0 };
+    size_t free_before = esp_get_free_heap_size();
+    for (int i = 0; i < LEAK_TEST_LOOPS; i++) {
+        jitter_buffer_handle_t h = jitter_buffer_pool_acquire(pool);
+        if (h == NULL) {
+            ESP_LOGE(TAG, "acquire failed at loop %d", i);
+            break;
+        }
+        jitter_buffer_start(h);
+        for (int j = 0; j < 5; j++) {
+            jitter_buffer_write(h, frame, sizeof(frame));
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+        jitter_buffer_pool_release(pool, h);
+    }
+    size_t free_after = esp_get_free_heap_size();
+    ESP_LOGI(TAG, "free heap before: %zu, after: %zu (diff=%d)", free_before, free_after, (int)(free_after - free_before));
+    jitter_buffer_pool_destroy(pool);
+}
+
 /** Case 1: 创建 -> start -> 写若干帧 -> reset -> 再写 -> destroy，检查 reset 与回收 */
 static void run_case_reset(void)
 {
@@ -340,14 +376,18 @@ void app_main(void)
     run_case_start_stop();
 #elif (JITTER_EXAMPLE_CASE == 3)
     run_case_normal();
+#elif (JITTER_EXAMPLE_CASE == 4)
+    run_case_pool();
 #else
-    /* 默认：先跑 0,1,2 再跑正常 case 3 */
+    /* 默认：先跑 0,1,2,4 再跑正常 case 3 */
     run_case_create_destroy_leak();
     vTaskDelay(pdMS_TO_TICKS(200));
     run_case_reset();
     vTaskDelay(pdMS_TO_TICKS(200));
     run_case_start_stop();
     vTaskDelay(pdMS_TO_TICKS(200));
+    run_case_pool();
+    vTaskDelay(pdMS_TO_TICKS(200));
     run_case_normal();
 #endif
 }
@@ -7,14 +7,17 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "esp_err.h"
 #include "esp_event.h"
+#include "freertos/FreeRTOS.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef void *jitter_buffer_handle_t;
+typedef void *jitter_buffer_scheduler_handle_t;  /**< See jitter_buffer_scheduler.h */
 
 /** State events posted to config.event_loop when non-NULL */
 ESP_EVENT_DECLARE_BASE(JITTER_BUFFER_EVENTS);
@@ -23,6 +26,9 @@ enum jitter_buffer_event_id {
     JITTER_EVENT_BUFFERING = 0,  /**< Enter buffering state */
     JITTER_EVENT_UNDERRUN,       /**< Enter underrun state */
     JITTER_EVENT_PLAYING,        /**< Enter playing state */
+    JITTER_EVENT_FLUSHED,        /**< jitter_buffer_flush() dropped the buffered data */
+    JITTER_EVENT_DRAINED,        /**< jitter_buffer_drain() played out the last frame, followed by JITTER_EVENT_BUFFERING */
+    JITTER_EVENT_SILENCE,        /**< dtx_suspend_ms: sender silence started, the playout task stops waking until audio arrives */
     JITTER_EVENT_MAX
 };
 
@@ -31,41 +37,325 @@ typedef enum {
     AUDIO_FORMAT_ID_PCM,
 } audio_format_id_t;
 
+/** What paces the playout task */
+typedef enum {
+    JITTER_CLOCK_TASK_TICK = 0,  /**< vTaskDelayUntil on the FreeRTOS tick, frame_interval is rounded to the tick period */
+    JITTER_CLOCK_ESP_TIMER,      /**< High-resolution esp_timer period of exactly frame_interval */
+    JITTER_CLOCK_EXTERNAL,       /**< One frame per jitter_buffer_clock_tick()/jitter_buffer_clock_tick_from_isr() call,
+                                      e.g. from the I2S DMA-done callback so playout follows the sink's sample clock */
+    JITTER_CLOCK_PULL,           /**< No playout task: the consumer calls jitter_buffer_read() once per frame,
+                                      on_output_data/on_output_frame are not used */
+} jitter_clock_source_t;
+
+/** Built-in concealment used for missing frames once playback has started */
+typedef enum {
+    JITTER_CONCEAL_NONE = 0,     /**< No concealment, output_silence_on_empty decides */
+    JITTER_CONCEAL_REPEAT_FADE,  /**< PCM (16-bit): repeat the last frame while fading it out over a few frames.
+                                      OPUS: output an empty frame (len 0) so the decoder runs its own PLC/FEC */
+} jitter_conceal_mode_t;
+
+/** with_header length prefix */
+typedef enum {
+    JITTER_HEADER_BE16 = 0,  /**< 2-byte big-endian length, payload < 65535 */
+    JITTER_HEADER_VARINT,    /**< 1 byte for payloads < 128, otherwise 2 bytes with the top bit as continuation bit;
+                                  payload < 32512. Saves 1 byte per frame for small Opus packets */
+} jitter_header_format_t;
+
+/** What a write does when the ring is full (FIFO mode) */
+typedef enum {
+    JITTER_OVERRUN_DROP_OLDEST = 0,  /**< Discard whole frames from the head to make room */
+    JITTER_OVERRUN_DROP_NEWEST,      /**< Reject the incoming frame with ESP_ERR_NO_MEM, buffered data is kept */
+    JITTER_OVERRUN_COMPRESS,         /**< Drop the oldest frames as needed, then drop one of every compress_interval
+                                          frames at playout until the depth is back at high_water */
+} jitter_overrun_policy_t;
+
+#define JITTER_TIMEOUT_NONE UINT32_MAX  /**< write_timeout_ms/read_timeout_ms: try the mutex once, never wait */
+
 #define DEFAULT_JITTER_BUFFER_CONFIG() {     \
     .on_output_data = NULL,                  \
+    .on_output_frame = NULL,                 \
     .with_header = false,                    \
+    .header_format = JITTER_HEADER_BE16,     \
+    .opus_duration = false,                  \
+    .contiguous_frames = false,              \
+    .pow2_ring = false,                      \
+    .align_frames = false,                   \
     .buffer_size = 11 * 1024,                \
+    .buffer_caps = 0,                        \
+    .user_buffer = NULL,                     \
     .frame_size = 512,                       \
     .frame_interval = 20,                    \
     .high_water = 20,                        \
     .low_water = 10,                         \
+    .start_water = 0,                        \
+    .packet_slots = 0,                       \
+    .adaptive_delay = false,                 \
+    .min_high_water = 3,                     \
+    .max_high_water = 40,                    \
+    .overrun_policy = JITTER_OVERRUN_DROP_OLDEST, \
+    .compress_interval = 4,                  \
     .output_silence_on_empty = false,        \
+    .dtx_suspend_ms = 0,                     \
     .audio_format_id = AUDIO_FORMAT_ID_OPUS, \
+    .conceal_mode = JITTER_CONCEAL_NONE,     \
+    .on_conceal = NULL,                      \
+    .drift_compensation = false,             \
+    .pcm_channels = 1,                       \
     .event_loop = NULL,                      \
+    .scheduler = NULL,                       \
+    .clock_source = JITTER_CLOCK_TASK_TICK,  \
+    .task_stack = 4096,                      \
+    .task_prio = 10,                         \
+    .task_core = 1,                          \
+    .task_stack_caps = 0,                    \
+    .lock_free = false,                      \
+    .write_timeout_ms = 50,                  \
+    .read_timeout_ms = 50,                   \
+    .trace_entries = 0,                      \
 }
 
+/** A writable region of ring memory; a reservation that crosses the wrap point is returned as two spans */
+typedef struct {
+    uint8_t *data;  /**< Start of the region, NULL when the span is unused */
+    size_t   len;   /**< Length of the region in bytes */
+} jitter_buffer_span_t;
+
+#define JITTER_BUFFER_RESIDENCE_BINS 16  /**< Bins of jitter_buffer_stats_t.residence_hist */
+
+/** Hot-path measurement points of CONFIG_JITTER_BUFFER_PROFILE, see jitter_buffer_stats_t.profile */
+typedef enum {
+    JITTER_PROFILE_WRITE = 0,      /**< A write call (write, write_nb, write_batch, write_packet, write_commit), lock wait included */
+    JITTER_PROFILE_WRITE_LOCK,     /**< Mutex wait of the write path */
+    JITTER_PROFILE_READ_LOCK,      /**< Mutex wait of a playout tick */
+    JITTER_PROFILE_FRAME_COUNT,    /**< Depth lookup of the playout state machine (with_header walks the ring headers) */
+    JITTER_PROFILE_READ_COPY,      /**< Copy of the frame out of the ring (copying output, drift compensation, pull) */
+    JITTER_PROFILE_CALLBACK,       /**< on_output_data/on_output_frame */
+    JITTER_PROFILE_TICK,           /**< A whole playout tick or jitter_buffer_read(), everything above included */
+    JITTER_PROFILE_MAX
+} jitter_profile_point_t;
+
+/** Time spent at one jitter_profile_point_t, in CPU cycles (microseconds on the linux target) */
+typedef struct {
+    uint32_t count;  /**< Measurements */
+    uint32_t min;
+    uint32_t max;
+    uint32_t avg;
+} jitter_buffer_profile_t;
+
+/** Runtime statistics, see jitter_buffer_get_stats(). Counters accumulate since create or jitter_buffer_reset_stats() */
+typedef struct {
+    uint32_t underrun_count;     /**< PLAYING -> UNDERRUN transitions */
+    uint32_t overrun_count;      /**< Writes that had to discard buffered data, or were dropped in lock_free mode */
+    size_t   total_written;      /**< Bytes accepted since create (wraps, not cleared by jitter_buffer_reset_stats()) */
+    size_t   total_read;         /**< Bytes consumed since create (wraps, not cleared by jitter_buffer_reset_stats()) */
+    uint32_t depth_frames;       /**< Current depth in frames */
+    size_t   depth_bytes;        /**< Current depth in bytes */
+    uint32_t depth_min;          /**< Minimum depth in frames seen at an output tick */
+    uint32_t depth_max;          /**< Maximum depth in frames seen at an output tick */
+    uint32_t depth_avg;          /**< Average depth in frames over output ticks */
+    uint32_t high_water;         /**< Effective high_water, differs from the config with adaptive_delay */
+    uint32_t low_water;          /**< Effective low_water */
+    uint32_t concealed_frames;   /**< Frames produced by packet-loss concealment */
+    uint32_t discarded_frames;   /**< Frames discarded by overrun, invalid headers, the packet window moving or reconfigure */
+    uint32_t overrun_drop_oldest; /**< Buffered frames discarded to make room (JITTER_OVERRUN_DROP_OLDEST/COMPRESS) */
+    uint32_t overrun_drop_newest; /**< Incoming frames rejected because the ring was full (DROP_NEWEST, lock_free) */
+    uint32_t overrun_compressed; /**< Frames dropped at playout by JITTER_OVERRUN_COMPRESS */
+    uint32_t adaptive_drops;     /**< Frames dropped by adaptive_delay to shrink latency */
+    uint32_t drift_inserted;     /**< drift_compensation: sample frames duplicated to slow playout down */
+    uint32_t drift_deleted;      /**< drift_compensation: sample frames removed to speed playout up */
+    uint32_t late_packets;       /**< Packet mode: packets that arrived after their playout time */
+    uint32_t duplicate_packets;  /**< Packet mode: duplicates dropped */
+    uint32_t lost_packets;       /**< Packet mode: ticks whose packet was missing */
+    uint32_t lock_timeouts;      /**< Writes and playout ticks that gave up after write_timeout_ms/read_timeout_ms */
+    uint32_t write_nb_staged;    /**< jitter_buffer_write_nb() calls that found the mutex held and staged the frame */
+    uint32_t write_nb_dropped;   /**< jitter_buffer_write_nb() calls that found the mutex held and the stage occupied */
+    uint32_t dtx_suspends;       /**< dtx_suspend_ms: times the playout tick was suspended for sender silence */
+    uint32_t dtx_dropped;        /**< dtx_suspend_ms: silence writes dropped while suspended */
+    uint32_t events_dropped;     /**< State events lost: event_loop stayed full until the deferred FIFO overflowed,
+                                      or a direct post from jitter_buffer_start() failed */
+    jitter_buffer_profile_t profile[JITTER_PROFILE_MAX]; /**< CONFIG_JITTER_BUFFER_PROFILE: per-point timing, all zero
+                                                              when profiling is compiled out */
+    uint32_t residence_hist[JITTER_BUFFER_RESIDENCE_BINS]; /**< Write-to-output time of sampled frames: bin i counts
+                                                                [i, i + 1) * frame_interval, the last bin is open-ended.
+                                                                One frame is tracked at a time, so the cost is independent
+                                                                of the frame rate */
+} jitter_buffer_stats_t;
+
+/** Kind of a trace entry, see trace_entries */
+typedef enum {
+    JITTER_TRACE_WRITE = 0,      /**< Accepted jitter_buffer_write()/write_batch()/write_commit(); seq is the write index.
+                                      Writes rejected with an error are not recorded */
+    JITTER_TRACE_WRITE_PACKET,   /**< jitter_buffer_write_packet(); seq is the packet sequence number */
+    JITTER_TRACE_OUT_FRAME,      /**< Playout tick output a buffered frame of len bytes */
+    JITTER_TRACE_OUT_CONCEAL,    /**< Playout tick output a concealment frame */
+    JITTER_TRACE_OUT_SILENCE,    /**< Playout tick output silence */
+    JITTER_TRACE_OUT_NONE,       /**< Playout tick output nothing (buffering, underrun, or empty without silence) */
+} jitter_trace_event_t;
+
+/** One recorded write or playout tick, 12 bytes */
+typedef struct {
+    uint32_t time_us;  /**< esp_timer_get_time(), low 32 bits (wraps every ~71 minutes) */
+    uint16_t len;      /**< Bytes written or output */
+    uint16_t seq;      /**< See jitter_trace_event_t; 0 for playout ticks */
+    uint8_t  event;    /**< jitter_trace_event_t */
+    uint8_t  state;    /**< State after the entry: 0 idle, 1 buffering, 2 playing, 3 underrun */
+    uint16_t depth;    /**< Buffered frames: before the write, or at the playout tick before dequeuing */
+} jitter_buffer_trace_entry_t;
+
+#define JITTER_TRACE_MAGIC   "JBTR"
+#define JITTER_TRACE_VERSION 1
+
+/** Header of a jitter_buffer_trace_dump() stream, followed by count entries; all fields are little-endian */
+typedef struct {
+    char     magic[4];        /**< JITTER_TRACE_MAGIC */
+    uint8_t  version;         /**< JITTER_TRACE_VERSION */
+    uint8_t  entry_size;      /**< sizeof(jitter_buffer_trace_entry_t) */
+    uint8_t  flags;           /**< bit 0: with_header, bit 1: packet mode */
+    uint8_t  reserved;
+    uint16_t frame_interval;  /**< Config of the recording buffer, so a replay can start from the same settings */
+    uint16_t high_water;      /**< Effective high_water at dump time */
+    uint16_t low_water;       /**< Effective low_water at dump time */
+    uint16_t reserved2;
+    uint32_t frame_size;
+    uint32_t count;           /**< Entries that follow */
+    uint32_t lost;            /**< Entries overwritten before they were read, since create */
+} jitter_buffer_trace_header_t;
+
+/** One frame of a jitter_buffer_write_batch() call */
+typedef struct {
+    const uint8_t *data;  /**< Frame data */
+    size_t         len;   /**< Frame length */
+} jitter_buffer_frame_t;
+
+/** A frame handed out by on_output_frame; it points into ring memory and is only valid during the callback */
+typedef struct {
+    const uint8_t *data;   /**< Frame data, or its first segment when the frame wraps */
+    size_t         len;    /**< Length of data */
+    const uint8_t *data2;  /**< Continuation after the wrap point, NULL when the frame is contiguous */
+    size_t         len2;   /**< Length of data2 */
+} jitter_buffer_output_frame_t;
+
 /** State event: event_data is a pointer to a copied jitter_buffer_handle_t; use *(jitter_buffer_handle_t *)event_data to get the handle */
 
 typedef struct {
     /* Callback */
     void (*on_output_data)(const uint8_t *data, size_t len);
+    void (*on_output_frame)(const jitter_buffer_output_frame_t *frame); /**< Zero-copy output, takes precedence over
+                                                                             on_output_data; the frame is released when
+                                                                             the callback returns */
 
     /* Buffer layout */
     size_t                   buffer_size;   /**< Ring buffer size in bytes */
-    bool                     with_header;   /**< true: variable-length frames stored as [2-byte BE length][payload] */
+    uint32_t                 buffer_caps;   /**< MALLOC_CAP_* for the ring and frame buffers, e.g. MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT
+                                                 to keep a small low-latency ring in SRAM; 0: prefer PSRAM, fall back to internal */
+    uint8_t                 *user_buffer;   /**< Optional caller-owned ring of buffer_size bytes (e.g. a static DRAM_ATTR array),
+                                                 used instead of allocating and never freed. buffer_size is not grown, so create
+                                                 fails if the layout needs more (see with_header, contiguous_frames, packet_slots) */
+    bool                     with_header;   /**< true: variable-length frames stored as [length][payload] */
+    jitter_header_format_t   header_format; /**< with_header: encoding of the length prefix */
     uint32_t                 frame_size;    /**< Fixed frame size (no header) or max payload per frame (with_header) */
+    bool                     opus_duration; /**< with_header + OPUS: parse each packet's TOC byte (RFC 6716) so the depth and the
+                                                 water marks count buffered milliseconds in frame_interval units, and each
+                                                 playout tick outputs as many packets as fit its frame_interval (a 40 ms
+                                                 packet every 2nd 20 ms tick, two 10 ms packets per tick). Not paced in
+                                                 JITTER_CLOCK_PULL, where every jitter_buffer_read() returns one packet */
+    bool                     contiguous_frames; /**< true: frames never wrap, so on_output_frame always gets a single segment.
+                                                     with_header pads the ring tail; without header buffer_size is rounded
+                                                     up to a multiple of frame_size and writes must be whole frames */
+    bool                     pow2_ring;     /**< true: round buffer_size up to a power of two so ring index wrapping is a mask
+                                                 instead of a division (FIFO mode; with contiguous_frames and no header,
+                                                 frame_size must then be a power of two too) */
+    bool                     align_frames;  /**< true: keep every frame payload 4-byte aligned in the ring for word or DMA copies.
+                                                 with_header uses a 4-byte header and pads each payload to a multiple of 4;
+                                                 without header frame_size and every write must be a multiple of 4 */
     uint32_t                 frame_interval; /**< Output interval (ms). For OPUS+output_silence_on_empty: 20/40/60/120 only */
     uint32_t                 high_water;    /**< Start playing when frame count reaches this */
     uint32_t                 low_water;     /**< Enter underrun when frame count drops below this */
+    uint32_t                 start_water;   /**< > 0: fast start, the first playout after start/reset begins at this
+                                                 many frames (< high_water, < min_high_water with adaptive_delay);
+                                                 low_water is scaled down until the depth has grown back to high_water
+                                                 (drift_compensation slows playout to do so), and an underrun meanwhile
+                                                 rebuffers to high_water. 0: disabled */
+    uint32_t                 packet_slots;  /**< > 0: packet mode, frames are written with jitter_buffer_write_packet() and
+                                                 played in sequence order; buffer_size is replaced by packet_slots * frame_size.
+                                                 Slots follow the offset from the next sequence number to play, so any
+                                                 value works across the 16-bit wrap. 0: plain FIFO */
+    bool                     adaptive_delay; /**< true: high_water/low_water follow the measured arrival jitter (RFC 3550
+                                                  estimator); high_water moves within [min_high_water, max_high_water],
+                                                  low_water keeps its configured ratio, and excess depth is shed gradually
+                                                  by dropping frames, quiet ones first */
+    uint32_t                 min_high_water; /**< adaptive_delay: lower bound of high_water (frames) */
+    uint32_t                 max_high_water; /**< adaptive_delay: upper bound of high_water (frames) */
+    jitter_overrun_policy_t  overrun_policy; /**< Full-ring handling; without header, drops are rounded up to whole frames
+                                                  so reads stay frame aligned. lock_free always drops the newest frame */
+    uint32_t                 compress_interval; /**< JITTER_OVERRUN_COMPRESS: drop 1 of every N frames at playout, N >= 2 */
 
     /* Audio format and silence */
     audio_format_id_t        audio_format_id;       /**< AUDIO_FORMAT_ID_OPUS or AUDIO_FORMAT_ID_PCM */
     bool                     output_silence_on_empty; /**< true: output silence when no data; false: skip on_output_data */
+    uint32_t                 dtx_suspend_ms; /**< > 0: once the buffer has been empty or held only sender silence (Opus
+                                                  DTX packets of at most 2 bytes, all-zero PCM writes) for this long, post
+                                                  JITTER_EVENT_SILENCE and stop the tick until audio is written; silence
+                                                  written meanwhile is dropped, and the tick resumes on its old phase.
+                                                  Own task with JITTER_CLOCK_TASK_TICK in FIFO mode only; 0: always tick */
+
+    /* Packet-loss concealment */
+    jitter_conceal_mode_t    conceal_mode;  /**< Built-in concealment for an empty tick while playing, before falling back
+                                                 to output_silence_on_empty; at most 3 consecutive frames are concealed */
+    size_t (*on_conceal)(const uint8_t *prev_frame, size_t prev_len, uint8_t *out, size_t max_len); /**< Custom concealment,
+                                                 overrides conceal_mode: build a frame from the last played one into out
+                                                 and return its length, 0 to fall back to silence */
+
+    /* Clock drift compensation (16-bit PCM, no header, FIFO mode) */
+    bool                     drift_compensation; /**< true: track the smoothed depth while playing and keep it near
+                                                      high_water, at most every 4th frame, by reading one sample frame
+                                                      more (or less) from the ring and deleting (or duplicating) one at
+                                                      a zero crossing. Output frames stay frame_size bytes: that is the
+                                                      len on_output_data/on_output_frame and jitter_buffer_read() get;
+                                                      frame_size must be a multiple of the sample frame */
+    uint8_t                  pcm_channels;  /**< drift_compensation: interleaved channels per sample frame, 0 is treated as 1 */
 
     /* Optional event notification */
     esp_event_loop_handle_t  event_loop;    /**< If non-NULL, post BUFFERING/UNDERRUN/PLAYING events */
+
+    /* Playout */
+    jitter_buffer_scheduler_handle_t scheduler; /**< NULL: own playout task. Otherwise output is driven by this shared
+                                                     scheduler's tick; frame_interval must match the scheduler's */
+    jitter_clock_source_t    clock_source;  /**< Own playout task pacing, must be JITTER_CLOCK_TASK_TICK with a scheduler */
+    uint32_t                 task_stack;    /**< Own playout task stack size in bytes; 0: use the defaults for every task
+                                                 field (4096 bytes, priority 10, core 1) */
+    uint32_t                 task_prio;     /**< Playout task priority */
+    int                      task_core;     /**< Core the playout task is pinned to, or tskNO_AFFINITY */
+    uint32_t                 task_stack_caps; /**< MALLOC_CAP_* for the task stack, e.g. MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+                                                   0: PSRAM when SPIRAM is enabled, else internal */
+
+    /* Concurrency */
+    bool                     lock_free;     /**< true: single-producer/single-consumer lock-free ring. Exactly one task may call
+                                                 jitter_buffer_write()/jitter_buffer_reset(); writes never block, and when the ring
+                                                 is full the incoming frame is dropped (ESP_ERR_NO_MEM) instead of the oldest */
+    uint32_t                 write_timeout_ms; /**< Mutex wait of the blocking writes (write, write_batch, write_packet,
+                                                    write_reserve, write_commit) before ESP_ERR_TIMEOUT;
+                                                    0: 50 ms; JITTER_TIMEOUT_NONE: try once */
+    uint32_t                 read_timeout_ms; /**< Mutex wait of a playout tick or jitter_buffer_read(); on timeout the tick
+                                                   outputs nothing; 0: 50 ms; JITTER_TIMEOUT_NONE: try once */
+
+    /* Diagnostics */
+    uint32_t                 trace_entries; /**< > 0: record every write and playout tick into a ring of this many
+                                                 jitter_buffer_trace_entry_t (buffer_caps placement, PSRAM by default);
+                                                 the oldest entries are overwritten, see jitter_buffer_trace_dump() */
 } jitter_buffer_config_t;
 
+/** New sizes for jitter_buffer_reconfigure(); a field left 0 keeps its current value */
+typedef struct {
+    size_t   buffer_size;     /**< Ring size in bytes, adjusted as at create (with_header minimum, contiguous_frames,
+                                   align_frames, pow2_ring) */
+    uint32_t frame_size;      /**< Frame size, or max payload with with_header */
+    uint32_t high_water;      /**< High water mark (frames) */
+    uint32_t low_water;       /**< Low water mark (frames) */
+    uint32_t min_high_water;  /**< adaptive_delay: lower bound of high_water */
+    uint32_t max_high_water;  /**< adaptive_delay: upper bound of high_water */
+} jitter_buffer_reconfig_t;
+
 /* Breif: Create a jitter buffer
  *
  * config[in]  The configuration of the jitter buffer
@@ -107,6 +397,9 @@ esp_err_t jitter_buffer_stop(jitter_buffer_handle_t handle);
 esp_err_t jitter_buffer_destroy(jitter_buffer_handle_t handle);
 
 /* Breif: Reset the jitter buffer
+ *
+ * In lock_free mode the reset must be issued from the producer task; buffered data is dropped by the
+ * playout task on its next tick.
  *
  * handle[in]  The handle of the jitter buffer
  *
@@ -116,6 +409,65 @@ esp_err_t jitter_buffer_destroy(jitter_buffer_handle_t handle);
  */
 esp_err_t jitter_buffer_reset(jitter_buffer_handle_t handle);
 
+/* Breif: Flush the jitter buffer without leaving playout
+ *
+ * Drops all buffered data like jitter_buffer_reset(), but a PLAYING buffer stays PLAYING and the playout clock keeps
+ * its phase: empty ticks until new data arrives are not counted as underruns, and playout resumes as soon as the
+ * depth reaches start_water (low_water when start_water is 0) instead of re-buffering to high_water. The depth then
+ * grows back as after a fast start. A pending jitter_buffer_drain() is cancelled. JITTER_EVENT_FLUSHED is posted when
+ * the data has been dropped; in lock_free mode the flush must be issued from the producer task and the data is
+ * dropped by the playout task on its next tick.
+ *
+ * handle[in]  The handle of the jitter buffer
+ *
+ * return:
+ *       - ESP_OK: Flush success
+ *       - Others: Flush failed
+ */
+esp_err_t jitter_buffer_flush(jitter_buffer_handle_t handle);
+
+/* Breif: Mark the end of the stream and play out the remaining frames
+ *
+ * Non-blocking. Until the buffer is empty, playout ignores low_water and starts immediately from BUFFERING/UNDERRUN,
+ * so the tail of an utterance is not stranded below the water marks. Frames written meanwhile are played as part of
+ * the tail. When the last frame has been output JITTER_EVENT_DRAINED is posted and the buffer returns to BUFFERING
+ * for the next stream. jitter_buffer_reset() and jitter_buffer_flush() cancel the drain.
+ *
+ * handle[in]  The handle of the jitter buffer
+ *
+ * return:
+ *       - ESP_OK: Drain started
+ *       - Others: Drain failed
+ */
+esp_err_t jitter_buffer_drain(jitter_buffer_handle_t handle);
+
+/* Breif: Resize the ring and change the water marks without stopping playout
+ *
+ * Blocking. The new ring, frame buffers and jitter_buffer_write_nb() stage are allocated by the caller; while
+ * playing, the playout tick swaps them in under the mutex before it outputs its frame, so the clock keeps its phase
+ * and no tick is skipped. Buffered frames are moved in order to the new ring; when they do not fit, the oldest are
+ * dropped, and with with_header frames longer than the new frame_size are dropped too (counted in discarded_frames).
+ * A PLAYING buffer stays PLAYING: below the new high_water it runs as after a fast start, with low_water scaled to
+ * the depth until the depth grows back. When stopped the change is applied by the caller. A pending
+ * jitter_buffer_write_reserve() or a jitter_buffer_write_nb() copying into the stage delays the swap to the next tick.
+ *
+ * Buffered PCM without header is moved byte for byte; when the sample format changes with frame_size, reconfigure
+ * at a stream boundary (jitter_buffer_drain() before, or jitter_buffer_flush() after).
+ *
+ * handle[in]    The handle of the jitter buffer
+ * reconfig[in]  New sizes, 0 fields keep the current value
+ *
+ * return:
+ *       - ESP_OK: Applied
+ *       - ESP_ERR_INVALID_ARG: The merged configuration fails the checks of jitter_buffer_create()
+ *       - ESP_ERR_NOT_SUPPORTED: lock_free or packet mode, a jitter_buffer_pool instance, resizing a user_buffer, or
+ *                                frame_size with the scheduler mixer
+ *       - ESP_ERR_NO_MEM: The new buffers cannot be allocated, nothing changed
+ *       - ESP_ERR_INVALID_STATE: Another reconfigure is in progress
+ *       - ESP_ERR_TIMEOUT: No playout tick (or jitter_buffer_read() in pull mode) ran in time, nothing changed
+ */
+esp_err_t jitter_buffer_reconfigure(jitter_buffer_handle_t handle, const jitter_buffer_reconfig_t *reconfig);
+
 /* Breif: Write data to the jitter buffer
  *
  * handle[in]  The handle of the jitter buffer
@@ -124,10 +476,216 @@ esp_err_t jitter_buffer_reset(jitter_buffer_handle_t handle);
  *
  * return:
  *       - ESP_OK: Write success
+ *       - ESP_ERR_NO_MEM: JITTER_OVERRUN_DROP_NEWEST or lock_free mode, the ring is full and the frame was dropped
  *       - Others: Write failed
  */
 esp_err_t jitter_buffer_write(jitter_buffer_handle_t handle, const uint8_t *data, size_t len);
 
+/* Breif: Write data without blocking on the mutex
+ *
+ * Same as jitter_buffer_write() but the mutex is only tried once, so it can be called from a network receive
+ * callback. When the mutex is held the frame is copied into a one-frame stage (up to frame_size bytes), which the
+ * next write or playout tick that takes the mutex merges in order. In lock_free mode this is jitter_buffer_write().
+ *
+ * handle[in]  The handle of the jitter buffer
+ * data[in]    The data to be written
+ * len[in]     The length of the data
+ *
+ * return:
+ *       - ESP_OK: Written, or staged
+ *       - ESP_ERR_TIMEOUT: The mutex was held and the stage was occupied (or len > frame_size), the frame was dropped
+ *       - ESP_ERR_NOT_SUPPORTED: Packet mode
+ *       - Others: As jitter_buffer_write()
+ */
+esp_err_t jitter_buffer_write_nb(jitter_buffer_handle_t handle, const uint8_t *data, size_t len);
+
+/* Breif: Write several frames received in one burst
+ *
+ * Equivalent to calling jitter_buffer_write() for each frame in order, but the lock is taken once, room
+ * for the whole batch is made in a single discard pass and the PLAYING transition is checked once at the end.
+ * If the batch does not fit in the ring at all, the oldest frames of the batch are overwritten as they
+ * would be by separate writes. Every frame is attempted even if one fails.
+ *
+ * handle[in]  The handle of the jitter buffer
+ * frames[in]  The frames to write
+ * count[in]   Number of frames
+ *
+ * return:
+ *       - ESP_OK: All frames written
+ *       - ESP_ERR_NO_MEM: JITTER_OVERRUN_DROP_NEWEST or lock_free mode, the ring filled up and the remaining frames were dropped
+ *       - Others: At least one frame failed, see jitter_buffer_write()
+ */
+esp_err_t jitter_buffer_write_batch(jitter_buffer_handle_t handle, const jitter_buffer_frame_t *frames, size_t count);
+
+/* Breif: Write one packet in packet mode (packet_slots > 0)
+ *
+ * Packets are stored by sequence number and played out one per frame_interval in sequence order, so
+ * packets arriving out of order are reordered. Duplicates and packets older than the playout point are
+ * dropped; a packet more than packet_slots ahead moves the playout window forward. A missing packet
+ * consumes its tick and is treated as empty (silence when output_silence_on_empty is set).
+ * Frame counts for high_water/low_water are the sequence span still to be played, gaps included.
+ *
+ * handle[in]     The handle of the jitter buffer
+ * seq[in]        16-bit packet sequence number, wraps naturally
+ * timestamp[in]  Media timestamp of the packet
+ * data[in]       Payload
+ * len[in]        Payload length (<= frame_size)
+ *
+ * return:
+ *       - ESP_OK: Stored, or dropped as late/duplicate
+ *       - ESP_ERR_NOT_SUPPORTED: packet_slots is 0
+ *       - ESP_ERR_INVALID_SIZE: len > frame_size
+ *       - Others: Write failed
+ */
+esp_err_t jitter_buffer_write_packet(jitter_buffer_handle_t handle, uint16_t seq, uint32_t timestamp, const uint8_t *data, size_t len);
+
+/* Breif: Reserve contiguous ring memory for one frame so it can be received or decoded in place
+ *
+ * The reserved region is always contiguous. In with_header mode the writer pads the tail of the ring when
+ * needed; without header the call fails with ESP_ERR_INVALID_SIZE if the region would cross the wrap point,
+ * use jitter_buffer_write_reserve_spans() instead. Space is made exactly as jitter_buffer_write() would,
+ * discarding old frames on overrun. Only one reservation may be outstanding, and jitter_buffer_write()
+ * is rejected until it is committed.
+ *
+ * handle[in]   The handle of the jitter buffer
+ * max_len[in]  Maximum payload length to reserve (<= frame_size in with_header mode)
+ * ptr[out]     Start of the reserved payload region
+ *
+ * return:
+ *       - ESP_OK: Reserve success
+ *       - ESP_ERR_INVALID_STATE: Another reservation is pending
+ *       - ESP_ERR_INVALID_SIZE: max_len is too large, or the region would wrap in non-header mode
+ *       - Others: Reserve failed
+ */
+esp_err_t jitter_buffer_write_reserve(jitter_buffer_handle_t handle, size_t max_len, uint8_t **ptr);
+
+/* Breif: Reserve ring memory for one frame as up to two spans split at the wrap point
+ *
+ * spans[1].len is 0 when the region does not wrap. The payload must be written to spans[0] first and then
+ * continue in spans[1].
+ *
+ * handle[in]   The handle of the jitter buffer
+ * max_len[in]  Maximum payload length to reserve (<= frame_size in with_header mode)
+ * spans[out]   The two reserved regions
+ *
+ * return:
+ *       - ESP_OK: Reserve success
+ *       - Others: Reserve failed, see jitter_buffer_write_reserve()
+ */
+esp_err_t jitter_buffer_write_reserve_spans(jitter_buffer_handle_t handle, size_t max_len, jitter_buffer_span_t spans[2]);
+
+/* Breif: Publish a frame written into a reserved region
+ *
+ * handle[in]      The handle of the jitter buffer
+ * actual_len[in]  Bytes actually written, 0 cancels the reservation
+ *
+ * return:
+ *       - ESP_OK: Commit success
+ *       - ESP_ERR_INVALID_STATE: No reservation pending, or it was invalidated by jitter_buffer_reset()
+ *       - ESP_ERR_INVALID_SIZE: actual_len is larger than the reserved length
+ */
+esp_err_t jitter_buffer_write_commit(jitter_buffer_handle_t handle, size_t actual_len);
+
+/* Breif: Read one frame (clock_source = JITTER_CLOCK_PULL)
+ *
+ * Blocks only while a writer holds the lock, for at most read_timeout_ms (JITTER_TIMEOUT_NONE or lock_free: never blocks).
+ * Runs the same playout state machine as the internal task, so each call is one playout tick:
+ * it returns the next frame, a concealment frame or a silence frame, as the callback would have received.
+ * Call it from a single consumer task at the frame_interval rate, e.g. the task feeding I2S.
+ *
+ * handle[in]   The handle of the jitter buffer
+ * out[out]     Destination buffer
+ * max_len[in]  Size of out, must be >= frame_size
+ * out_len[out] Bytes written to out; 0 with ESP_OK is the Opus concealment marker (see conceal_mode)
+ *
+ * return:
+ *       - ESP_OK: A frame was written to out
+ *       - ESP_ERR_NOT_FOUND: Nothing to play this tick (buffering, underrun or empty with output_silence_on_empty false)
+ *       - ESP_ERR_INVALID_STATE: Not in pull mode or not started
+ *       - ESP_ERR_INVALID_SIZE: max_len is too small
+ *       - ESP_ERR_TIMEOUT: The lock was not obtained within read_timeout_ms; nothing was consumed, retry next frame
+ *       - ESP_FAIL: No ring buffer
+ */
+esp_err_t jitter_buffer_read(jitter_buffer_handle_t handle, uint8_t *out, size_t max_len, size_t *out_len);
+
+/* Breif: Request one output frame (clock_source = JITTER_CLOCK_EXTERNAL)
+ *
+ * Ticks that arrive while the playout task is busy are queued and played back to back.
+ *
+ * handle[in]  The handle of the jitter buffer
+ *
+ * return:
+ *       - ESP_OK: Tick delivered
+ *       - ESP_ERR_INVALID_STATE: clock_source is not JITTER_CLOCK_EXTERNAL
+ */
+esp_err_t jitter_buffer_clock_tick(jitter_buffer_handle_t handle);
+
+/* Breif: ISR variant of jitter_buffer_clock_tick(), placed in IRAM
+ *
+ * No argument checking is done; the buffer must use JITTER_CLOCK_EXTERNAL.
+ *
+ * handle[in]                       The handle of the jitter buffer
+ * higher_priority_task_woken[out]  Set to pdTRUE when a context switch should be requested before the ISR exits
+ */
+void jitter_buffer_clock_tick_from_isr(jitter_buffer_handle_t handle, BaseType_t *higher_priority_task_woken);
+
+/* Breif: Get runtime statistics
+ *
+ * Cheap enough to poll from production firmware. In lock_free mode the snapshot is taken without a lock
+ * and individual fields may be slightly inconsistent with each other.
+ *
+ * handle[in]  The handle of the jitter buffer
+ * stats[out]  The statistics
+ *
+ * return:
+ *       - ESP_OK: Success
+ *       - Others: Failed
+ */
+esp_err_t jitter_buffer_get_stats(jitter_buffer_handle_t handle, jitter_buffer_stats_t *stats);
+
+/* Breif: Clear the accumulated counters, depth min/max/avg and the residence histogram
+ *
+ * handle[in]  The handle of the jitter buffer
+ *
+ * return:
+ *       - ESP_OK: Success
+ *       - Others: Failed
+ */
+esp_err_t jitter_buffer_reset_stats(jitter_buffer_handle_t handle);
+
+/* Breif: Take the oldest recorded trace entries (trace_entries > 0)
+ *
+ * Entries are removed from the ring as they are read, so the trace can be streamed while the buffer runs.
+ *
+ * handle[in]     The handle of the jitter buffer
+ * entries[out]   Destination array
+ * max_count[in]  Capacity of entries
+ * count[out]     Number of entries copied
+ *
+ * return:
+ *       - ESP_OK: Success, count may be 0
+ *       - ESP_ERR_NOT_SUPPORTED: trace_entries is 0
+ */
+esp_err_t jitter_buffer_trace_read(jitter_buffer_handle_t handle, jitter_buffer_trace_entry_t *entries, size_t max_count,
+                                   size_t *count);
+
+/* Breif: Write the recorded trace as a jitter_buffer_trace_header_t followed by the entries, and remove them
+ *
+ * Dump to a file (SD card, SPIFFS, or a host file on the linux target) with hex = false. With hex = true the same
+ * bytes are printed as text lines prefixed with "jbtr:", which survive a serial console, e.g. out = stdout over UART;
+ * the lines can be cut from a monitor log and replayed by examples/host_benchmark.
+ *
+ * handle[in]  The handle of the jitter buffer
+ * out[in]     Destination stream
+ * hex[in]     true: hex text lines, false: raw binary
+ *
+ * return:
+ *       - ESP_OK: Success
+ *       - ESP_ERR_NOT_SUPPORTED: trace_entries is 0
+ *       - ESP_FAIL: Write to out failed
+ */
+esp_err_t jitter_buffer_trace_dump(jitter_buffer_handle_t handle, FILE *out, bool hex);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "jitter_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A pool creates count jitter buffers with one configuration up front and hands them out per session, so
+ * products that open and close a stream per call or TTS prompt do not allocate and free the ring, the task
+ * stack and the FreeRTOS objects every time; after days of such cycles the heap stays unfragmented.
+ *
+ * jitter_buffer_pool_acquire() returns an idle instance (stopped, empty, statistics cleared); start it and use
+ * it like any other handle. jitter_buffer_pool_release() stops it if needed and recycles it: the buffered
+ * data, statistics and trace are dropped and the water marks return to the configured values, while the task
+ * and all memory are kept. Released handles must not be used by the caller any more. Pool instances keep the
+ * pool configuration, so jitter_buffer_reconfigure() returns ESP_ERR_NOT_SUPPORTED on them.
+ */
+
+typedef void *jitter_buffer_pool_handle_t;
+
+/* Breif: Create a pool of jitter buffers
+ *
+ * Every instance is created with jitter_buffer_create(config); all of them share one configuration, so the
+ * output callbacks and the event loop are common to the sessions. config->user_buffer is only allowed when
+ * count is 1.
+ *
+ * config[in]  The configuration of every instance
+ * count[in]   The number of instances, i.e. the maximum number of concurrent sessions
+ *
+ * return:
+ *       - NULL: Create failed
+ *       - Others: The handle of the pool
+ */
+jitter_buffer_pool_handle_t jitter_buffer_pool_create(const jitter_buffer_config_t *config, uint32_t count);
+
+/* Breif: Destroy the pool and all of its jitter buffers
+ *
+ * handle[in]  The handle of the pool
+ *
+ * return:
+ *       - ESP_OK: Destroy success
+ *       - ESP_ERR_INVALID_STATE: Instances are still acquired
+ *       - Others: Destroy failed
+ */
+esp_err_t jitter_buffer_pool_destroy(jitter_buffer_pool_handle_t handle);
+
+/* Breif: Take an idle jitter buffer from the pool
+ *
+ * The instance is stopped and empty; call jitter_buffer_start() to begin the session.
+ *
+ * handle[in]  The handle of the pool
+ *
+ * return:
+ *       - NULL: Every instance is in use
+ *       - Others: The handle of the jitter buffer
+ */
+jitter_buffer_handle_t jitter_buffer_pool_acquire(jitter_buffer_pool_handle_t handle);
+
+/* Breif: Return a jitter buffer to the pool
+ *
+ * Stops the instance if it is started (waits for its current tick, so do not call from its output callbacks),
+ * then drops its data, statistics and trace. No allocation or free happens.
+ *
+ * handle[in]  The handle of the pool
+ * jb[in]      A handle returned by jitter_buffer_pool_acquire() on this pool
+ *
+ * return:
+ *       - ESP_OK: Release success
+ *       - ESP_ERR_INVALID_ARG: jb does not belong to the pool
+ *       - ESP_ERR_INVALID_STATE: jb is not acquired
+ */
+esp_err_t jitter_buffer_pool_release(jitter_buffer_pool_handle_t handle, jitter_buffer_handle_t jb);
+
+/* Breif: Number of idle instances
+ *
+ * handle[in]  The handle of the pool
+ *
+ * return:
+ *       - The number of instances jitter_buffer_pool_acquire() can still hand out
+ */
+uint32_t jitter_buffer_pool_available(jitter_buffer_pool_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "jitter_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A scheduler drives several jitter buffers from one task on one tick. Buffers created with
+ * config.scheduler set do not spawn their own task; on every tick each started buffer outputs one frame
+ * in creation order, then on_tick is called once, so all streams deliver aligned frames.
+ *
+ * With mix_frame_size > 0 the scheduler is a mixer: on every tick it pulls one frame from each started buffer
+ * instead of calling their output callbacks, sums them with per-stream gain and int16 saturation, and hands
+ * the result to on_mix_output. Buffers that are buffering, in underrun or not started contribute silence.
+ */
+
+#define JITTER_MIX_GAIN_UNITY 4096  /**< Q12 gain of 1.0, see jitter_buffer_scheduler_set_gain() */
+#define JITTER_MIX_GAIN_MAX   (8 * JITTER_MIX_GAIN_UNITY)
+
+#define DEFAULT_JITTER_BUFFER_SCHEDULER_CONFIG() { \
+    .frame_interval = 20,                          \
+    .max_streams = 8,                              \
+    .task_stack = 4096,                            \
+    .task_prio = 10,                               \
+    .task_core = 1,                                \
+    .task_stack_caps = 0,                          \
+    .on_tick = NULL,                               \
+    .mix_frame_size = 0,                           \
+    .on_mix_output = NULL,                         \
+    .ctx = NULL,                                   \
+}
+
+typedef struct {
+    uint32_t  frame_interval;       /**< Tick period (ms); every attached buffer must use the same frame_interval */
+    uint32_t  max_streams;          /**< Maximum number of attached buffers */
+    uint32_t  task_stack;           /**< Scheduler task stack size in bytes */
+    uint32_t  task_prio;            /**< Scheduler task priority */
+    int       task_core;            /**< Core the scheduler task is pinned to, or tskNO_AFFINITY */
+    uint32_t  task_stack_caps;      /**< MALLOC_CAP_* for the task stack; 0: PSRAM when SPIRAM is enabled, else internal */
+    void (*on_tick)(void *ctx);     /**< Optional, called after every stream has output its frame for this tick,
+                                         e.g. to mix the frames collected by the output callbacks */
+    uint32_t  mix_frame_size;       /**< > 0: mixer mode, bytes of interleaved 16-bit PCM per tick; attached buffers
+                                         must be AUDIO_FORMAT_ID_PCM without header, with this frame_size, and need
+                                         no output callback. 0: each buffer calls its own output callback */
+    void (*on_mix_output)(const int16_t *pcm, size_t len, void *ctx); /**< Mixer mode: the mixed frame, len in bytes
+                                                                           (mix_frame_size), called every tick even
+                                                                           when all streams are silent */
+    void     *ctx;                  /**< User context passed to on_tick and on_mix_output */
+} jitter_buffer_scheduler_config_t;
+
+/* Breif: Create a scheduler and start its task
+ *
+ * config[in]  The configuration of the scheduler
+ *
+ * return:
+ *       - NULL: Create failed
+ *       - Others: The handle of the scheduler
+ */
+jitter_buffer_scheduler_handle_t jitter_buffer_scheduler_create(const jitter_buffer_scheduler_config_t *config);
+
+/* Breif: Stop the scheduler task and free the scheduler
+ *
+ * All jitter buffers using the scheduler must be destroyed first.
+ *
+ * handle[in]  The handle of the scheduler
+ *
+ * return:
+ *       - ESP_OK: Destroy success
+ *       - ESP_ERR_INVALID_STATE: Jitter buffers are still attached
+ *       - Others: Destroy failed
+ */
+esp_err_t jitter_buffer_scheduler_destroy(jitter_buffer_scheduler_handle_t handle);
+
+/* Breif: Set the mixing gain of an attached jitter buffer (mixer mode)
+ *
+ * Takes effect from the next tick. A gain of 0 mutes the stream, its frames are still consumed.
+ *
+ * handle[in]  The handle of the scheduler
+ * stream[in]  A jitter buffer created with config.scheduler = handle
+ * gain_q12[in] Q12 gain, JITTER_MIX_GAIN_UNITY is 1.0; values above JITTER_MIX_GAIN_MAX are clamped
+ *
+ * return:
+ *       - ESP_OK: Success
+ *       - ESP_ERR_NOT_SUPPORTED: The scheduler is not in mixer mode
+ *       - ESP_ERR_NOT_FOUND: stream is not attached to the scheduler
+ */
+esp_err_t jitter_buffer_scheduler_set_gain(jitter_buffer_scheduler_handle_t handle, jitter_buffer_handle_t stream,
+                                           uint32_t gain_q12);
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,10 +7,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -18,6 +21,35 @@
 #include "freertos/event_groups.h"
 
 #include "jitter_buffer.h"
+#include "jitter_buffer_priv.h"
+
+#if defined(CONFIG_JITTER_BUFFER_PROFILE)
+#if CONFIG_IDF_TARGET_LINUX
+#define JITTER_PROF_NOW() ((uint32_t)esp_timer_get_time())  /* linux 目标没有周期计数器，按微秒计 */
+#else
+#include "esp_cpu.h"
+#define JITTER_PROF_NOW() esp_cpu_get_cycle_count()
+#endif  /* CONFIG_IDF_TARGET_LINUX */
+#if defined(CONFIG_JITTER_BUFFER_PROFILE_SYSVIEW)
+#include "SEGGER_SYSVIEW.h"
+#define JITTER_PROF_SV_ID(point)    (0x100 + (unsigned)(point))
+#define JITTER_PROF_SV_START(point) SEGGER_SYSVIEW_OnUserStart(JITTER_PROF_SV_ID(point))
+#define JITTER_PROF_SV_STOP(point)  SEGGER_SYSVIEW_OnUserStop(JITTER_PROF_SV_ID(point))
+#else
+#define JITTER_PROF_SV_START(point)
+#define JITTER_PROF_SV_STOP(point)
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE_SYSVIEW) */
+/* 测量点：BEGIN 声明起始计数 t，END 计入 point 的累加器，DROP 用于未计入就返回的错误路径
+ * 同一 point 的 END 只在持锁时（写端）或只由消费者（读端）调用，累加器无需再加锁 */
+#define JITTER_PROF_BEGIN(point, t)   JITTER_PROF_SV_START(point); uint32_t t = JITTER_PROF_NOW()
+#define JITTER_PROF_END(jb, point, t) s_prof_add(jb, point, JITTER_PROF_NOW() - (t))
+#define JITTER_PROF_DROP(point)       JITTER_PROF_SV_STOP(point)
+#else
+/* 未开启 CONFIG_JITTER_BUFFER_PROFILE 时测量点不产生任何代码 */
+#define JITTER_PROF_BEGIN(point, t)
+#define JITTER_PROF_END(jb, point, t)
+#define JITTER_PROF_DROP(point)
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE) */
 
 #define JITTER_BUFFER_EVENT_START (1 << 0)
 #define JITTER_BUFFER_EVENT_STOP  (1 << 1)
@@ -26,6 +58,52 @@
 #define JITTER_BUFFER_EVENT_ACK (1 << 0)
 
 #define JITTER_HEADER_LEN 2  /* with_header 时长度字段：大端 2 字节 */
+#define JITTER_ALIGN      4  /* align_frames：帧 payload 与记录长度的对齐字节数，with_header 时帧头补齐到此长度 */
+#define JITTER_HEADER_WRAP 0xFFFF  /* with_header 时的对齐填充标记，其后直到缓冲末尾的字节均为填充 */
+
+/* JITTER_HEADER_VARINT：< 128 为单字节长度；否则首字节最高位为延续位，
+ * 2 字节大端 [1xxxxxxx][xxxxxxxx] 表示 15 位长度；首字节 0xFF 为对齐填充标记，故长度 < 0x7F00 */
+#define JITTER_VARINT_SHORT_MAX 0x80
+#define JITTER_VARINT_MAX       0x7F00
+#define JITTER_VARINT_WRAP      0xFF
+#define JITTER_OPUS_MAX_US      120000  /* RFC 6716 3.2.5：一个 Opus 包最长 120 ms */
+
+#define JITTER_EVENT_WAIT_MS   10  /* 一次 s_defer_flush() 等待事件循环队列的总时长，用完后剩余记录留到下一拍 */
+#define JITTER_LOCK_TIMEOUT_MS 50  /* 统计/trace 等非数据路径的 mutex 等待；写/读路径见 write_timeout_ms/read_timeout_ms */
+#define JITTER_IO_TIMEOUT_DEFAULT_MS 50  /* write_timeout_ms/read_timeout_ms 为 0（未从默认配置初始化）时沿用旧版本的等待 */
+#define JITTER_RECONFIG_WAIT_FRAMES 4  /* reconfigure 等待消费者换入缓冲的拍数，另加 JITTER_LOCK_TIMEOUT_MS */
+
+/* write_nb 暂存槽状态：只有 CAS EMPTY->FILLING 成功的生产者可写入，持锁方把 FULL 并入环形缓冲后置回 EMPTY */
+#define JITTER_STAGE_EMPTY   0
+#define JITTER_STAGE_FILLING 1
+#define JITTER_STAGE_FULL    2
+
+#define JITTER_TASK_STACK_DEFAULT 4096
+#define JITTER_TASK_EXIT_WAIT_MS  500  /* destroy 等待 WithCaps 任务挂起后再释放其栈 */
+#define JITTER_TASK_PRIO_DEFAULT  10
+#define JITTER_TASK_CORE_DEFAULT  1
+
+#define JITTER_PACKET_SLOTS_MAX 32768  /* 包模式序号窗口不超过 16 位序号空间的一半 */
+#define JITTER_READ_GAP         (-2)   /* 包模式：本拍对应的包丢失或尚未到达 */
+#define JITTER_READ_TIMEOUT     (-3)   /* read_timeout_ms 内未取得 mutex，本拍未消费任何数据 */
+
+#define JITTER_CONCEAL_MAX_FRAMES 3    /* 连续隐藏的最大帧数，之后按 output_silence_on_empty 处理 */
+
+/* adaptive_delay：目标深度 = ceil(K * J / frame_interval) + 1，J 为 RFC 3550 到达抖动估计 */
+#define JITTER_ADAPT_K            4
+#define JITTER_ADAPT_DROP_GAP     4    /* 收缩时两次丢帧至少间隔的输出拍数 */
+#define JITTER_ADAPT_FORCE_TICKS  50   /* 超过此拍数仍无低能量帧时直接丢弃下一帧 */
+#define JITTER_ADAPT_QUIET_PCM    256  /* 16 位 PCM 峰值低于此值视为低能量帧（约 -42 dBFS） */
+#define JITTER_ADAPT_QUIET_OPUS   8    /* Opus 包长不超过此值视为静音/DTX 帧 */
+
+/* drift_compensation：平滑深度偏离 high_water 超过半帧时，每 JITTER_DRIFT_EVERY 帧插入/删除一个采样帧
+ * 320 采样帧/帧时最大校正约 780 ppm，足以覆盖常见的 50~200 ppm 时钟偏差 */
+#define JITTER_DRIFT_EVERY        4
+#define JITTER_DRIFT_SMOOTH_SHIFT 6    /* 深度 EWMA 系数 1/64 */
+
+#define JITTER_DEFER_SLOTS 16  /* 延迟事件/日志 FIFO 深度；锁内只入队，由播放路径在锁外发出 */
+
+#define JITTER_TRACE_CHUNK 32  /* trace 每次在临界区内拷出的最大条数，限制关中断时间 */
 
 ESP_EVENT_DEFINE_BASE(JITTER_BUFFER_EVENTS);
 
@@ -38,24 +116,175 @@ typedef enum {
     JITTER_STATE_UNDERRUN,   // 欠载，需要重新缓冲
 } jitter_buffer_state_t;
 
+/* 锁内产生、锁外发出的事件与日志 */
+typedef enum {
+    JITTER_DEFER_EVENT,             /* a: 状态事件 id */
+    JITTER_DEFER_LOG_PLAYING,       /* a: 帧数 */
+    JITTER_DEFER_LOG_UNDERRUN,      /* a: 帧数，b: 欠载次数 */
+    JITTER_DEFER_LOG_DROP_OLDEST,   /* a: 丢弃帧数，b: 溢出次数 */
+    JITTER_DEFER_LOG_DROP_NEWEST,   /* a: 丢弃字节数，b: 溢出次数 */
+    JITTER_DEFER_LOG_ALIGN_LOST,    /* a: 丢弃字节数 */
+} jitter_defer_kind_t;
+
+typedef struct {
+    uint8_t  kind;
+    uint32_t a;
+    uint32_t b;
+} jitter_defer_t;
+
+#if defined(CONFIG_JITTER_BUFFER_PROFILE)
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} jitter_prof_acc_t;
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE) */
+
+/* 包模式槽位元数据，payload 存放于 buffer + index * frame_size */
+typedef struct {
+    uint32_t timestamp;
+    uint16_t seq;
+    uint16_t len;
+    bool     valid;
+} jitter_packet_slot_t;
+
+/* jitter_buffer_reconfigure() 的请求：调用方按新配置分配好缓冲，消费者在一拍开始时持锁换入
+ * 换入后各缓冲指针改为指向被换出的旧缓冲，由调用方释放；NULL 表示该缓冲不变 */
+typedef struct {
+    jitter_buffer_reconfig_t want;          /* 0 值已替换为当前配置 */
+    uint8_t                *buffer;
+    size_t                  buffer_size;    /* 按 s_ring_layout() 调整后的大小 */
+    size_t                  buffer_mask;
+    uint8_t                *frame_buffer;
+    size_t                  frame_buffer_size;
+    uint8_t                *prev_frame;
+    uint8_t                *stage;
+    uint32_t                kept;           /* 迁移到新缓冲的帧数 */
+    uint32_t                dropped;        /* 新缓冲放不下或超过新 frame_size 而丢弃的帧数 */
+    _Atomic bool            done;
+    _Atomic bool            aborted;        /* 实例被池回收时撤回，未换入 */
+} jitter_reconfig_t;
+
 typedef struct {
     jitter_buffer_config_t  config;
     uint8_t                *buffer;
     size_t                  buffer_size;
+    size_t                  buffer_mask;    /* pow2_ring 时为 buffer_size - 1，环形下标回绕用掩码代替取模；否则为 0 */
     size_t                  write_pos;
     size_t                  read_pos;
-    size_t                  data_size;
-    size_t                  total_read;
-    size_t                  total_written;
+    _Atomic size_t          data_size;      /* 生产者/消费者共享，lock_free 模式下作为发布点 */
+    _Atomic size_t          frame_count;    /* with_header 时缓冲内完整帧个数，随写/读/丢弃增量维护 */
+    _Atomic uint32_t        buffered_us;    /* opus_duration：缓冲内各包按 TOC 解析的总时长，与 frame_count 同步维护 */
+    int32_t                 pace_credit_us; /* opus_duration：播放节拍累积的可输出时长，按包时长扣除（仅消费者） */
+    uint32_t                pace_gen_seen;  /* opus_duration：消费者已处理的 reset_gen + flush_gen，变化时清零 pace_credit_us */
+    size_t                  total_read;     /* 仅消费者修改 */
+    size_t                  total_written;  /* 仅生产者修改 */
+    _Atomic size_t          reset_mark;     /* lock_free：reset 时的 total_written，消费者丢弃到此位置 */
+    _Atomic uint32_t        reset_gen;      /* reset 请求计数；lock_free 时消费者据此丢弃数据 */
+    uint32_t                reset_gen_seen; /* lock_free：消费者已处理的 reset 请求计数 */
+    size_t                  reserve_len;    /* write_reserve 预留的 payload 长度 */
+    size_t                  reserve_pad;    /* write_reserve 为保证 payload 连续而在末尾填充的字节数 */
+    size_t                  reserve_hdr_len; /* write_reserve 按 max_len 确定的帧头长度，提交时沿用 */
+    bool                    reserved;
+    _Atomic size_t          borrowed;       /* mutex 模式：已出队但仍在输出回调中使用的字节数，写端不可覆盖 */
+    size_t                  pending_release; /* lock_free 模式：输出回调返回后待出队的字节数 */
+    jitter_packet_slot_t   *slots;          /* 包模式（packet_slots > 0）槽位数组，NULL 为 FIFO 模式 */
+    uint16_t                next_seq;       /* 包模式：下一个待播放的序号 */
+    uint32_t                next_index;     /* 包模式：next_seq 所在的槽位，与 next_seq 同步推进；不按 seq % packet_slots
+                                             * 计算，packet_slots 不整除 65536 时序号回绕处也不会有两个序号落在同一槽位 */
+    uint16_t                highest_seq;    /* 包模式：已收到的最大序号 */
+    bool                    seq_started;    /* 包模式：已收到首包，next_seq/highest_seq 有效 */
+    bool                    seq_played;     /* 包模式：本轮已输出过包，之后迟到包不再回拨 next_seq */
+    _Atomic int32_t         borrowed_slot;  /* 包模式：输出回调中使用的槽位，-1 表示无 */
+    _Atomic uint32_t        high_water;     /* 当前生效的高/低水位，adaptive_delay 时由写端按抖动调整 */
+    _Atomic uint32_t        low_water;
+    _Atomic bool            fast_start;     /* start_water：start/reset 后置位，深度长到 high_water 或欠载时清除 */
+    _Atomic uint32_t        ramp_depth;     /* fast_start：起播后达到过的最大深度（帧），低水位按它等比缩小 */
+    _Atomic bool            flush_hold;     /* flush 后保持 PLAYING，深度达到 s_flush_resume() 前的空拍不算欠载 */
+    _Atomic uint32_t        flush_gen;      /* flush 请求计数，消费者据此清除隐藏与漂移状态 */
+    uint32_t                flush_gen_seen; /* 消费者已处理的 flush 请求计数 */
+    _Atomic bool            draining;       /* drain：忽略低水位播完剩余帧，读空后发 DRAINED 并回到 BUFFERING */
+    int64_t                 last_arrival_us; /* adaptive_delay：上一次写入时间，0 表示尚无 */
+    int64_t                 expected_us;    /* adaptive_delay：两次写入之间按帧间隔应经过的时间 */
+    uint16_t                last_arrival_seq;
+    uint32_t                jitter_q4;      /* adaptive_delay：到达抖动估计（微秒，Q4 定点） */
+    uint32_t                shrink_wait;    /* adaptive_delay：深度超出目标后已等待的输出拍数（仅消费者） */
+    uint32_t                adapt_drop_count;
+    uint8_t                *prev_frame;     /* 丢包隐藏：最近一次真实输出的帧，未启用隐藏时为 NULL（仅消费者） */
+    size_t                  prev_len;
+    uint32_t                conceal_count;  /* 当前连续隐藏的帧数 */
+    uint32_t                conceal_count_total;
+    int64_t                 drift_depth_q4; /* drift_compensation：播放中的平滑深度（字节，Q4 定点，仅消费者） */
+    bool                    drift_valid;    /* drift_depth_q4 已初始化；离开 PLAYING 时清除 */
+    uint32_t                drift_ticks;
+    uint32_t                drift_inserted;
+    uint32_t                drift_deleted;
+    uint32_t                drop_oldest_count; /* overrun 时从队头丢弃的帧数 */
+    uint32_t                drop_newest_count; /* overrun 时被拒绝写入的帧数 */
+    bool                    compressing;    /* JITTER_OVERRUN_COMPRESS：overrun 后置位，深度回到 high_water 时由消费者清除 */
+    uint32_t                compress_ticks;
+    uint32_t                compress_count;
+    uint32_t                discard_count;  /* 因 overrun、非法帧头或包窗口推进而丢弃的帧数 */
+    uint32_t                depth_min;      /* 每个输出拍采样的深度（帧），jitter_buffer_reset_stats() 清零 */
+    uint32_t                depth_max;
+    uint64_t                depth_sum;
+    uint32_t                depth_samples;
+    /* 驻留时间采样：同一时刻只跟踪一帧，写入时打时间戳，消费者读过该帧时计入直方图 */
+    _Atomic bool            sample_pending;
+    size_t                  sample_countdown; /* 消费者还需读过的字节数，含被采样帧本身 */
+    uint16_t                sample_seq;     /* 包模式：被采样包的序号 */
+    int64_t                 sample_time_us;
+    uint32_t                residence_hist[JITTER_BUFFER_RESIDENCE_BINS];
+    uint32_t                late_count;
+    uint32_t                duplicate_count;
+    uint32_t                lost_count;
+    /* 延迟事件/日志 FIFO：defer_lock 只保护入队/出队的几条指令，生产者与消费者都可入队 */
+    jitter_defer_t          defer[JITTER_DEFER_SLOTS];
+    uint32_t                defer_head;
+    uint32_t                defer_tail;
+    uint32_t                defer_lost;     /* FIFO 满时丢弃的记录数 */
+    portMUX_TYPE            defer_lock;
+    _Atomic bool            defer_flushing; /* 同一时刻只有一方出队，队首记录可先发出再移除 */
+    /* 到达/输出 trace（trace_entries > 0）：trace_lock 只保护入队/出队，满时覆盖最旧记录 */
+    jitter_buffer_trace_entry_t *trace;
+    uint32_t                trace_start;
+    uint32_t                trace_count;
+    uint32_t                trace_lost;
+    uint16_t                trace_write_seq; /* 非包模式写入的序号（写入次数） */
+    uint16_t                trace_depth;    /* 本拍出队前的深度（仅消费者） */
+    portMUX_TYPE            trace_lock;
     uint8_t                *frame_buffer;
-    jitter_buffer_state_t   state;
+    size_t                  frame_buffer_size; /* frame_size，drift_compensation 时多留一个采样帧 */
+    _Atomic jitter_buffer_state_t state;
+    _Atomic bool            active;         /* start 之后、stop 之前；调度器/拉模式只在此期间输出 */
     SemaphoreHandle_t       mutex;
     EventGroupHandle_t      event_group;
     EventGroupHandle_t      event_group_ack;
     TaskHandle_t            task_handle;
+    bool                    task_with_caps; /* 任务以 xTaskCreatePinnedToCoreWithCaps() 创建，destroy 时需 vTaskDeleteWithCaps() */
+    esp_timer_handle_t      clock_timer;    /* clock_source 为 JITTER_CLOCK_ESP_TIMER 时的周期定时器 */
     TickType_t              last_wake_time;
     uint32_t                underrun_count;
     uint32_t                overrun_count;
+    /* write_nb 暂存槽（mutex FIFO 模式）：锁被占用时暂存一帧，下次持锁写入或播放一拍时按序并入 */
+    uint8_t                *stage;
+    size_t                  stage_len;
+    _Atomic uint8_t         stage_state;
+    _Atomic uint32_t        lock_timeouts;  /* 写/读路径等待 mutex 超时次数 */
+    _Atomic uint32_t        nb_staged;
+    _Atomic uint32_t        nb_dropped;
+    _Atomic uint32_t        events_dropped; /* 未能发到 event_loop 的状态事件 */
+    /* dtx_suspend_ms：发送端静音期间挂起播放节拍，写入音频时由写端唤醒 */
+    uint32_t                dtx_silence_us; /* 连续没有音频输出（空拍或静音帧）的时长（仅消费者） */
+    _Atomic bool            dtx_suspended;
+    uint32_t                dtx_suspends;
+    _Atomic uint32_t        dtx_dropped;
+    _Atomic(jitter_reconfig_t *) reconfig; /* 待消费者处理的 jitter_buffer_reconfigure() 请求，NULL 表示无 */
+    bool                    pooled;         /* jitter_buffer_pool 的实例，配置在各会话间保持不变 */
+#if defined(CONFIG_JITTER_BUFFER_PROFILE)
+    jitter_prof_acc_t       prof[JITTER_PROFILE_MAX];
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE) */
     bool                    running;
 } jitter_buffer_t;
 
@@ -96,521 +325,2968 @@ static const opus_silence_t opus_silence[] = {
 };
 
 static int s_jitter_buffer_read(jitter_buffer_t *jitter_buffer, uint8_t *data, size_t len);
+static int s_jitter_buffer_acquire(jitter_buffer_t *jitter_buffer, size_t len, jitter_buffer_output_frame_t *frame);
+static void s_jitter_buffer_release(jitter_buffer_t *jitter_buffer);
+static void s_stage_merge(jitter_buffer_t *jb);
+
+static inline esp_err_t s_event_post(jitter_buffer_t *jb, int32_t event_id, TickType_t wait)
+{
+    jitter_buffer_handle_t h = (jitter_buffer_handle_t)jb;
+    return esp_event_post_to(jb->config.event_loop, JITTER_BUFFER_EVENTS, event_id, &h, sizeof(h), wait);
+}
 
-/** 状态切换时向 config.event_loop 发送事件（若已配置） */
-static void s_post_state_event(jitter_buffer_t *jb, int32_t event_id)
+/** 状态切换时向 config.event_loop 发送事件（若已配置）；不可在持有 mutex 时调用，锁内用 s_defer() */
+static void s_post_state_event(jitter_buffer_t *jb, int32_t event_id, TickType_t wait)
 {
     if (jb->config.event_loop == NULL) {
         return;
     }
-    jitter_buffer_handle_t h = (jitter_buffer_handle_t)jb;
-    esp_err_t ret = esp_event_post_to(jb->config.event_loop, JITTER_BUFFER_EVENTS, event_id,
-                                      &h, sizeof(h), pdMS_TO_TICKS(100));
+    esp_err_t ret = s_event_post(jb, event_id, wait);
     if (ret != ESP_OK) {
+        atomic_fetch_add(&jb->events_dropped, 1);
         ESP_LOGW(TAG, "esp_event_post_to failed: %s", esp_err_to_name(ret));
     }
 }
 
-/* 环形缓冲原始写（调用方需已持有 mutex，且保证有空间或已先 discard） */
-static void s_ring_write(jitter_buffer_t *jb, const uint8_t *data, size_t len)
+/* 记录一条延迟发出的事件/日志，FIFO 满时丢弃并计数 */
+static void s_defer(jitter_buffer_t *jb, jitter_defer_kind_t kind, uint32_t a, uint32_t b)
+{
+    if (kind == JITTER_DEFER_EVENT && jb->config.event_loop == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&jb->defer_lock);
+    if (jb->defer_head - jb->defer_tail < JITTER_DEFER_SLOTS) {
+        jitter_defer_t *d = &jb->defer[jb->defer_head % JITTER_DEFER_SLOTS];
+        d->kind = (uint8_t)kind;
+        d->a = a;
+        d->b = b;
+        jb->defer_head++;
+    } else {
+        jb->defer_lost++;
+        if (kind == JITTER_DEFER_EVENT) {
+            atomic_fetch_add(&jb->events_dropped, 1);
+        }
+    }
+    portEXIT_CRITICAL(&jb->defer_lock);
+}
+
+/* 在锁外按入队顺序发出延迟记录；由播放路径每拍调用
+ * 整次出队等待事件循环队列的总时长不超过 JITTER_EVENT_WAIT_MS，用完后队列仍满则停止，其余记录留到下一拍 */
+static void s_defer_flush(jitter_buffer_t *jb)
+{
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&jb->defer_flushing, &expected, true)) {
+        return;  /* 另一方正在出队，本次入队的记录由它或下一次 flush 发出 */
+    }
+    TickType_t start = xTaskGetTickCount();
+    TickType_t budget = pdMS_TO_TICKS(JITTER_EVENT_WAIT_MS);
+    while (1) {
+        portENTER_CRITICAL(&jb->defer_lock);
+        if (jb->defer_tail == jb->defer_head) {
+            uint32_t lost = jb->defer_lost;
+            jb->defer_lost = 0;
+            portEXIT_CRITICAL(&jb->defer_lock);
+            if (lost > 0) {
+                ESP_LOGW(TAG, "Jitter buffer: %lu deferred event/log record(s) dropped", (unsigned long)lost);
+            }
+            break;
+        }
+        jitter_defer_t d = jb->defer[jb->defer_tail % JITTER_DEFER_SLOTS];
+        portEXIT_CRITICAL(&jb->defer_lock);
+
+        if (d.kind == JITTER_DEFER_EVENT) {
+            TickType_t spent = xTaskGetTickCount() - start;
+            if (s_event_post(jb, (int32_t)d.a, spent < budget ? budget - spent : 0) != ESP_OK) {
+                break;  /* 留在队首，下一次 flush 重发；FIFO 因此写满时新事件计入 events_dropped */
+            }
+        }
+        portENTER_CRITICAL(&jb->defer_lock);
+        jb->defer_tail++;
+        portEXIT_CRITICAL(&jb->defer_lock);
+
+        switch (d.kind) {
+        case JITTER_DEFER_LOG_PLAYING:
+            ESP_LOGI(TAG, "Jitter buffer: start playing, frames=%lu", (unsigned long)d.a);
+            break;
+        case JITTER_DEFER_LOG_UNDERRUN:
+            ESP_LOGW(TAG, "Jitter buffer underrun: frames=%lu, count=%lu", (unsigned long)d.a, (unsigned long)d.b);
+            break;
+        case JITTER_DEFER_LOG_DROP_OLDEST:
+            ESP_LOGW(TAG, "Jitter buffer overrun: discarded %lu frame(s), count=%lu", (unsigned long)d.a, (unsigned long)d.b);
+            break;
+        case JITTER_DEFER_LOG_DROP_NEWEST:
+            ESP_LOGW(TAG, "Jitter buffer overrun: drop incoming %lu bytes, count=%lu", (unsigned long)d.a, (unsigned long)d.b);
+            break;
+        case JITTER_DEFER_LOG_ALIGN_LOST:
+            ESP_LOGW(TAG, "Jitter buffer overrun: alignment lost, discarded %lu bytes", (unsigned long)d.a);
+            break;
+        default:
+            break;
+        }
+    }
+    atomic_store(&jb->defer_flushing, false);
+}
+
+/* 记录一次写入或一拍输出；生产者与消费者都可调用 */
+static void s_trace(jitter_buffer_t *jb, jitter_trace_event_t event, size_t len, uint16_t seq, size_t depth)
+{
+    if (jb->trace == NULL) {
+        return;
+    }
+    uint32_t n = jb->config.trace_entries;
+    portENTER_CRITICAL(&jb->trace_lock);
+    jitter_buffer_trace_entry_t *e = &jb->trace[(jb->trace_start + jb->trace_count) % n];
+    if (jb->trace_count == n) {
+        jb->trace_start = (jb->trace_start + 1) % n;
+        jb->trace_lost++;
+    } else {
+        jb->trace_count++;
+    }
+    e->time_us = (uint32_t)esp_timer_get_time();
+    e->len = len > UINT16_MAX ? UINT16_MAX : (uint16_t)len;
+    e->seq = seq;
+    e->event = (uint8_t)event;
+    e->state = (uint8_t)atomic_load(&jb->state);
+    e->depth = depth > UINT16_MAX ? UINT16_MAX : (uint16_t)depth;
+    portEXIT_CRITICAL(&jb->trace_lock);
+}
+
+/* 加锁；lock_free 模式下生产者/消费者各自只改自己的索引，无需加锁 */
+static inline bool s_lock(jitter_buffer_t *jb, TickType_t wait)
+{
+    if (jb->config.lock_free) {
+        return true;
+    }
+    return xSemaphoreTake(jb->mutex, wait) == pdTRUE;
+}
+
+static inline void s_unlock(jitter_buffer_t *jb)
+{
+    if (!jb->config.lock_free) {
+        xSemaphoreGive(jb->mutex);
+    }
+}
+
+/* 写/读路径加锁，按配置的超时等待，超时计入统计；0 按旧版本等待 50 ms，JITTER_TIMEOUT_NONE 只尝试一次 */
+static inline bool s_lock_timed(jitter_buffer_t *jb, uint32_t timeout_ms)
+{
+    TickType_t wait = 0;
+    if (timeout_ms == 0) {
+        wait = pdMS_TO_TICKS(JITTER_IO_TIMEOUT_DEFAULT_MS);
+    } else if (timeout_ms != JITTER_TIMEOUT_NONE) {
+        wait = pdMS_TO_TICKS(timeout_ms);
+    }
+    if (s_lock(jb, wait)) {
+        return true;
+    }
+    atomic_fetch_add(&jb->lock_timeouts, 1);
+    return false;
+}
+
+#if defined(CONFIG_JITTER_BUFFER_PROFILE)
+static void s_prof_add(jitter_buffer_t *jb, jitter_profile_point_t point, uint32_t cycles)
+{
+    JITTER_PROF_SV_STOP(point);
+    jitter_prof_acc_t *acc = &jb->prof[point];
+    if (acc->count == 0 || cycles < acc->min) {
+        acc->min = cycles;
+    }
+    if (cycles > acc->max) {
+        acc->max = cycles;
+    }
+    acc->sum += cycles;
+    acc->count++;
+}
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE) */
+
+/* 状态切换（CAS），成功返回 true；生产者与消费者并发切换时只有一方成功并负责发事件 */
+static inline bool s_state_transit(jitter_buffer_t *jb, jitter_buffer_state_t from, jitter_buffer_state_t to)
+{
+    return atomic_compare_exchange_strong(&jb->state, &from, to);
+}
+
+/* 驻留时间计入直方图，按 frame_interval 分档（消费者侧） */
+static void s_record_residence(jitter_buffer_t *jb, int64_t residence_us)
+{
+    int64_t bin = residence_us / ((int64_t)jb->config.frame_interval * 1000);
+    if (bin < 0) {
+        bin = 0;
+    } else if (bin >= JITTER_BUFFER_RESIDENCE_BINS) {
+        bin = JITTER_BUFFER_RESIDENCE_BINS - 1;
+    }
+    jb->residence_hist[bin]++;
+    atomic_store(&jb->sample_pending, false);
+}
+
+/* 生产者：刚发布的帧末尾距 read_pos 为 data_size 字节，空闲时对其采样 */
+static inline void s_sample_arrival(jitter_buffer_t *jb)
+{
+    if (!atomic_load(&jb->sample_pending)) {
+        jb->sample_countdown = atomic_load(&jb->data_size);
+        jb->sample_time_us = esp_timer_get_time();
+        atomic_store(&jb->sample_pending, true);
+    }
+}
+
+/* 环形下标回绕，pos < 2 * buffer_size */
+static inline size_t s_ring_wrap(jitter_buffer_t *jb, size_t pos)
+{
+    return jb->buffer_mask != 0 ? (pos & jb->buffer_mask) : pos % jb->buffer_size;
+}
+
+/* 向环形缓冲 pos 处拷贝数据，不更新 write_pos/data_size（调用方需已持有 mutex） */
+static void s_ring_copy_in(jitter_buffer_t *jb, size_t pos, const uint8_t *data, size_t len)
 {
     if (len == 0) {
         return;
     }
-    size_t first = jb->buffer_size - jb->write_pos;
+    size_t first = jb->buffer_size - pos;
     if (first >= len) {
-        memcpy(jb->buffer + jb->write_pos, data, len);
+        memcpy(jb->buffer + pos, data, len);
     } else {
-        memcpy(jb->buffer + jb->write_pos, data, first);
+        memcpy(jb->buffer + pos, data, first);
         memcpy(jb->buffer, data + first, len - first);
     }
-    jb->write_pos = (jb->write_pos + len) % jb->buffer_size;
+}
+
+/* 从环形缓冲 pos 处拷出 len 字节（调用方需已持有 mutex） */
+static void s_ring_copy_out(jitter_buffer_t *jb, size_t pos, uint8_t *data, size_t len)
+{
+    size_t first = jb->buffer_size - pos;
+    if (first >= len) {
+        memcpy(data, jb->buffer + pos, len);
+    } else {
+        memcpy(data, jb->buffer + pos, first);
+        memcpy(data + first, jb->buffer, len - first);
+    }
+}
+
+/* 发布 write_pos 之后已写好的 len 字节，消费者从此刻起可见
+ * 先拷贝再更新 data_size，lock_free 模式下消费者只会看到已完整写入的数据 */
+static void s_ring_publish(jitter_buffer_t *jb, size_t len)
+{
+    jb->write_pos = s_ring_wrap(jb, jb->write_pos + len);
     jb->data_size += len;
     jb->total_written += len;
 }
 
-/* 环形缓冲 peek，不移动 read_pos（调用方需已持有 mutex） */
-static void s_ring_peek(jitter_buffer_t *jb, uint8_t *buf, size_t len)
+/* 环形缓冲原始写（调用方需已持有 mutex，且保证有空间或已先 discard） */
+static void s_ring_write(jitter_buffer_t *jb, const uint8_t *data, size_t len)
 {
-    size_t to_read = (len < jb->data_size) ? len : jb->data_size;
-    if (to_read == 0) {
+    if (len == 0) {
         return;
     }
-    size_t first = jb->buffer_size - jb->read_pos;
-    if (first >= to_read) {
-        memcpy(buf, jb->buffer + jb->read_pos, to_read);
+    s_ring_copy_in(jb, jb->write_pos, data, len);
+    s_ring_publish(jb, len);
+}
+
+/* 环形缓冲丢弃 len 字节（消费者侧，调用方需已持有 mutex 或为 lock_free 消费者） */
+static void s_ring_skip(jitter_buffer_t *jb, size_t len)
+{
+    jb->read_pos = s_ring_wrap(jb, jb->read_pos + len);
+    jb->data_size -= len;
+    jb->total_read += len;
+    if (atomic_load(&jb->sample_pending)) {
+        if (len >= jb->sample_countdown) {
+            s_record_residence(jb, esp_timer_get_time() - jb->sample_time_us);
+        } else {
+            jb->sample_countdown -= len;
+        }
+    }
+}
+
+/* 生产者侧 overrun 丢弃 len 字节，不计入 total_read（调用方需已持有 mutex） */
+static void s_ring_drop(jitter_buffer_t *jb, size_t len)
+{
+    jb->read_pos = s_ring_wrap(jb, jb->read_pos + len);
+    jb->data_size -= len;
+    if (atomic_load(&jb->sample_pending)) {
+        /* 被采样帧被丢弃则放弃本次采样 */
+        if (len >= jb->sample_countdown) {
+            atomic_store(&jb->sample_pending, false);
+        } else {
+            jb->sample_countdown -= len;
+        }
+    }
+}
+
+/* with_header 时 payload 的长度上限（不含） */
+static inline size_t s_header_payload_max(const jitter_buffer_config_t *config)
+{
+    return config->header_format == JITTER_HEADER_VARINT ? JITTER_VARINT_MAX : JITTER_HEADER_WRAP;
+}
+
+/* with_header 时 len 字节 payload 的最短帧头长度 */
+static inline size_t s_header_len(jitter_buffer_t *jb, size_t len)
+{
+    if (jb->config.align_frames) {
+        return JITTER_ALIGN;  /* 长度字段后补零，payload 从对齐处开始 */
+    }
+    if (jb->config.header_format == JITTER_HEADER_VARINT) {
+        return len < JITTER_VARINT_SHORT_MAX ? 1 : 2;
+    }
+    return JITTER_HEADER_LEN;
+}
+
+/* 按 hdr_len 字节编码帧头；VARINT 时 hdr_len 可大于最短长度（预留时按 max_len 定长，提交的帧可能更短） */
+static void s_header_encode(jitter_buffer_t *jb, size_t len, size_t hdr_len, uint8_t hdr[JITTER_ALIGN])
+{
+    memset(hdr, 0, JITTER_ALIGN);
+    if (jb->config.header_format == JITTER_HEADER_VARINT && hdr_len == 1) {
+        hdr[0] = (uint8_t)len;
+    } else if (jb->config.header_format == JITTER_HEADER_VARINT) {
+        hdr[0] = (uint8_t)(0x80 | ((len >> 8) & 0x7f));
+        hdr[1] = (uint8_t)(len & 0xff);
     } else {
-        memcpy(buf, jb->buffer + jb->read_pos, first);
-        memcpy(buf + first, jb->buffer, to_read - first);
+        hdr[0] = (uint8_t)((len >> 8) & 0xff);
+        hdr[1] = (uint8_t)(len & 0xff);
     }
 }
 
-/* 环形缓冲原始读，返回实际读到的字节数（调用方需已持有 mutex） */
-static size_t s_ring_read(jitter_buffer_t *jb, uint8_t *data, size_t len)
+/* with_header 时一条记录中 payload 所占字节数，align_frames 时含补齐到 JITTER_ALIGN 的尾部填充 */
+static inline size_t s_record_payload(jitter_buffer_t *jb, size_t len)
+{
+    return jb->config.align_frames ? (len + JITTER_ALIGN - 1) & ~(size_t)(JITTER_ALIGN - 1) : len;
+}
+
+/* Opus 包的时长（微秒），按 RFC 6716 3.1 节的 TOC 字节：config 决定单帧时长，code 决定帧数，code 3 的帧数在第 2 字节
+ * 空包（len 为 0，解码器 PLC）或非法包（code 3 帧数为 0、总时长超过 120 ms）返回 0，播放时按一拍计 */
+static uint32_t s_opus_duration_us(uint8_t toc, uint8_t count_byte, size_t len)
 {
-    size_t to_read = (len < jb->data_size) ? len : jb->data_size;
-    if (to_read == 0) {
+    static const uint16_t silk_us[4] = { 10000, 20000, 40000, 60000 };
+    static const uint16_t celt_us[4] = { 2500, 5000, 10000, 20000 };
+    if (len == 0) {
         return 0;
     }
-    size_t first = jb->buffer_size - jb->read_pos;
-    if (first >= to_read) {
-        memcpy(data, jb->buffer + jb->read_pos, to_read);
+    uint8_t config = toc >> 3;
+    uint32_t frame_us;
+    if (config < 12) {
+        frame_us = silk_us[config & 3];
+    } else if (config < 16) {
+        frame_us = (config & 1) ? 20000 : 10000;  /* Hybrid */
     } else {
-        memcpy(data, jb->buffer + jb->read_pos, first);
-        memcpy(data + first, jb->buffer, to_read - first);
+        frame_us = celt_us[config & 3];
+    }
+    uint32_t frames;
+    switch (toc & 3) {
+    case 0:
+        frames = 1;
+        break;
+    case 3:
+        frames = len >= 2 ? (count_byte & 0x3f) : 0;
+        break;
+    default:
+        frames = 2;
+        break;
     }
-    jb->read_pos = (jb->read_pos + to_read) % jb->buffer_size;
-    jb->data_size -= to_read;
-    jb->total_read += to_read;
-    return to_read;
+    uint32_t us = frame_us * frames;
+    return us <= JITTER_OPUS_MAX_US ? us : 0;
 }
 
-/* with_header 时从 read_pos 起逐帧解析，返回完整帧个数（调用方需已持有 mutex） */
-static size_t s_get_frame_count_with_header(jitter_buffer_t *jb)
+/* opus_duration：环形缓冲 pos 处 len 字节 Opus 包的时长，未启用时返回 0 */
+static inline uint32_t s_ring_opus_us(jitter_buffer_t *jb, size_t pos, size_t len)
 {
-    size_t offset = 0;
-    size_t remaining = jb->data_size;
-    size_t count = 0;
+    if (!jb->config.opus_duration || len == 0) {
+        return 0;
+    }
+    uint8_t count_byte = len > 1 ? jb->buffer[s_ring_wrap(jb, pos + 1)] : 0;
+    return s_opus_duration_us(jb->buffer[pos], count_byte, len);
+}
 
-    while (remaining >= JITTER_HEADER_LEN) {
-        uint8_t b0 = jb->buffer[(jb->read_pos + offset) % jb->buffer_size];
-        uint8_t b1 = jb->buffer[(jb->read_pos + offset + 1) % jb->buffer_size];
-        uint16_t L = (uint16_t)((b0 << 8) | b1);
-        /* 防止异常长度导致死循环，单帧不超过 buffer 一半视为合理 */
-        if (L > jb->buffer_size / 2) {
-            break;
+/* with_header 时解析 read_pos 偏移 offset 处的一条记录，avail 为从该处起可用的字节数
+ * 返回记录总字节数（含头），数据未到齐返回 0；*payload_len 为帧 payload 长度，对齐填充记录为 SIZE_MAX
+ * payload 位于记录末尾（align_frames 时之后还有尾部填充），即偏移 rec_len - s_record_payload(*payload_len) 处 */
+static size_t s_peek_record(jitter_buffer_t *jb, size_t offset, size_t avail, size_t *payload_len)
+{
+    if (avail == 0) {
+        return 0;
+    }
+    size_t pos = s_ring_wrap(jb, jb->read_pos + offset);
+    uint8_t b0 = jb->buffer[pos];
+    size_t hdr_len;
+    size_t L = 0;
+    bool wrap;
+    if (jb->config.header_format == JITTER_HEADER_VARINT) {
+        wrap = (b0 == JITTER_VARINT_WRAP);
+        hdr_len = (b0 & 0x80) ? 2 : 1;
+        L = b0;
+    } else {
+        wrap = false;
+        hdr_len = JITTER_HEADER_LEN;
+    }
+    if (!wrap && hdr_len > 1) {
+        if (avail < hdr_len) {
+            return 0;
         }
-        if (remaining < JITTER_HEADER_LEN + L) {
-            break;
+        uint8_t b1 = jb->buffer[s_ring_wrap(jb, pos + 1)];
+        if (jb->config.header_format == JITTER_HEADER_VARINT) {
+            L = ((size_t)(b0 & 0x7f) << 8) | b1;
+        } else {
+            L = ((size_t)b0 << 8) | b1;
+            wrap = (L == JITTER_HEADER_WRAP);
         }
-        count++;
-        offset += JITTER_HEADER_LEN + L;
-        remaining -= (JITTER_HEADER_LEN + L);
     }
-    return count;
+    size_t rec_len;
+    if (wrap) {
+        /* 填充到缓冲末尾，下一条记录从 0 开始 */
+        *payload_len = SIZE_MAX;
+        rec_len = jb->buffer_size - pos;
+    } else {
+        *payload_len = L;
+        if (jb->config.align_frames) {
+            hdr_len = JITTER_ALIGN;
+        }
+        rec_len = hdr_len + s_record_payload(jb, L);
+    }
+    return (avail < rec_len) ? 0 : rec_len;
 }
 
-static esp_err_t s_jitter_buffer_process(jitter_buffer_t *jitter_buffer)
+/* with_header：read_pos 偏移 offset 处的帧即将出队或被丢弃，同步更新 frame_count 与 buffered_us */
+static inline void s_frame_removed(jitter_buffer_t *jb, size_t offset, size_t rec_len, size_t payload_len)
 {
-
-    vTaskDelayUntil(&jitter_buffer->last_wake_time, pdMS_TO_TICKS(jitter_buffer->config.frame_interval));
-    int read_len = s_jitter_buffer_read(jitter_buffer, jitter_buffer->frame_buffer, jitter_buffer->config.frame_size);
-    if (read_len > 0) {
-        jitter_buffer->config.on_output_data(jitter_buffer->frame_buffer, read_len);
-    } else if (read_len == 0 && jitter_buffer->config.output_silence_on_empty) {
-        if (jitter_buffer->config.audio_format_id == AUDIO_FORMAT_ID_OPUS) {
-            int index = jitter_buffer->config.frame_interval / 20;
-            int output_len = opus_silence[index].len;
-            memcpy(jitter_buffer->frame_buffer, opus_silence[index].data, output_len);
-            jitter_buffer->config.on_output_data(jitter_buffer->frame_buffer, output_len);
-        } else {
-            memset(jitter_buffer->frame_buffer, 0, jitter_buffer->config.frame_size);
-            jitter_buffer->config.on_output_data(jitter_buffer->frame_buffer, jitter_buffer->config.frame_size);
-        }
+    if (jb->config.opus_duration) {
+        size_t pos = s_ring_wrap(jb, jb->read_pos + offset + rec_len - s_record_payload(jb, payload_len));
+        atomic_fetch_sub(&jb->buffered_us, s_ring_opus_us(jb, pos, payload_len));
     }
-    return ESP_OK;
+    jb->frame_count--;
 }
 
-static void jitter_buffer_task(void *arg)
+/* with_header 时从 read_pos 起逐帧解析，返回完整帧个数，opus_duration 时同时重算 buffered_us（调用方需已持有 mutex）
+ * 仅在帧对齐丢失后用于重建 frame_count，常规路径使用 s_get_frame_count() */
+static size_t s_get_frame_count_with_header(jitter_buffer_t *jb)
 {
-    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)arg;
-    jitter_buffer->running = true;
-    while (jitter_buffer->running) {
-        EventBits_t bits = xEventGroupWaitBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START | JITTER_BUFFER_EVENT_EXIT, pdTRUE, pdFALSE, portMAX_DELAY);
-        if (bits & JITTER_BUFFER_EVENT_EXIT) {
-            ESP_LOGI(TAG, "Jitter buffer task exit");
+    size_t offset = 0;
+    size_t remaining = jb->data_size;
+    size_t count = 0;
+    uint32_t duration_us = 0;
+
+    while (remaining > 0) {
+        size_t payload_len;
+        size_t rec_len = s_peek_record(jb, offset, remaining, &payload_len);
+        if (rec_len == 0) {
             break;
         }
-        xEventGroupSetBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START);
-        if (bits & JITTER_BUFFER_EVENT_START) {
-            jitter_buffer->last_wake_time = xTaskGetTickCount();
-            if (jitter_buffer->event_group_ack != NULL) {
-                xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
-            }
-            while (1) {
-                EventBits_t bits = xEventGroupWaitBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START | JITTER_BUFFER_EVENT_EXIT | JITTER_BUFFER_EVENT_STOP, pdFALSE, pdFALSE, portMAX_DELAY);
-                if (bits & JITTER_BUFFER_EVENT_EXIT) {
-                    ESP_LOGI(TAG, "Jitter buffer task exit");
-                    jitter_buffer->running = false;
-                    break;
-                }
-                if (bits & JITTER_BUFFER_EVENT_STOP) {
-                    ESP_LOGI(TAG, "Jitter buffer task stop");
-                    if (jitter_buffer->event_group_ack != NULL) {
-                        xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
-                    }
-                    break;
-                }
-                if (bits & JITTER_BUFFER_EVENT_START) {
-                    if (jitter_buffer->event_group_ack != NULL) {
-                        xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
-                    }
-                }
-                s_jitter_buffer_process(jitter_buffer);
+        if (payload_len != SIZE_MAX) {
+            /* 防止异常长度导致死循环，单帧不超过 buffer 一半视为合理 */
+            if (payload_len > jb->buffer_size / 2) {
+                break;
             }
+            count++;
+            duration_us += s_ring_opus_us(jb, s_ring_wrap(jb, jb->read_pos + offset + rec_len - s_record_payload(jb, payload_len)),
+                                          payload_len);
         }
+        offset += rec_len;
+        remaining -= rec_len;
     }
-    if (jitter_buffer->event_group_ack != NULL) {
-        xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
-    }
-    vTaskDelete(NULL);
+    atomic_store(&jb->buffered_us, duration_us);
+    return count;
 }
 
-static int s_jitter_buffer_read(jitter_buffer_t *jitter_buffer, uint8_t *data, size_t len)
+/* 包模式：next_seq 之后第 diff 个序号（-packet_slots < diff < packet_slots）所在的槽位 */
+static inline uint32_t s_slot_index(jitter_buffer_t *jb, int32_t diff)
 {
-    if (jitter_buffer->buffer == NULL || jitter_buffer->mutex == NULL) {
-        return -1;
+    int32_t slots = (int32_t)jb->config.packet_slots;
+    int32_t index = (int32_t)jb->next_index + diff;
+    if (index >= slots) {
+        index -= slots;
+    } else if (index < 0) {
+        index += slots;
     }
+    return (uint32_t)index;
+}
 
-    if (xSemaphoreTake(jitter_buffer->mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
-        ESP_LOGW(TAG, "Jitter buffer read: mutex timeout");
-        return -1;
+/* 当前缓冲帧数，O(1)（调用方需已持有 mutex） */
+static inline size_t s_get_frame_count(jitter_buffer_t *jb)
+{
+    if (jb->slots != NULL) {
+        /* 包模式：待播放的序号跨度，缺失的包也占一拍 */
+        int16_t span = (int16_t)(jb->highest_seq - jb->next_seq);
+        return (jb->seq_started && span >= 0) ? (size_t)span + 1 : 0;
     }
-
-    size_t frame_count = jitter_buffer->config.with_header
-        ? s_get_frame_count_with_header(jitter_buffer)
-        : (jitter_buffer->data_size / jitter_buffer->config.frame_size);
-
-    // 状态机：在读路径也检查高水位，避免“刚切到 PLAYING 时 buffer 已满、下一拍写 overrun”
-    if (jitter_buffer->state == JITTER_STATE_BUFFERING ||
-        jitter_buffer->state == JITTER_STATE_UNDERRUN) {
-        if (frame_count >= jitter_buffer->config.high_water) {
-            jitter_buffer->state = JITTER_STATE_PLAYING;
-            s_post_state_event(jitter_buffer, JITTER_EVENT_PLAYING);
-            ESP_LOGI(TAG, "Jitter buffer: start playing (read path), frames=%zu", frame_count);
-        } else {
-            xSemaphoreGive(jitter_buffer->mutex);
-            return 0;
-        }
+    if (jb->config.opus_duration) {
+        /* 按时长折算为 frame_interval 帧数，向上取整：缓冲内还有不足一拍的包时仍可播放 */
+        uint32_t interval_us = jb->config.frame_interval * 1000;
+        return (atomic_load(&jb->buffered_us) + interval_us - 1) / interval_us;
     }
+    return jb->config.with_header ? atomic_load(&jb->frame_count) : (atomic_load(&jb->data_size) / jb->config.frame_size);
+}
 
-    // 状态机：低于低水位时进入欠载状态
-    if (jitter_buffer->state == JITTER_STATE_PLAYING) {
-        if (frame_count < jitter_buffer->config.low_water) {
-            jitter_buffer->state = JITTER_STATE_UNDERRUN;
-            jitter_buffer->underrun_count++;
-            s_post_state_event(jitter_buffer, JITTER_EVENT_UNDERRUN);
-            ESP_LOGW(TAG, "Jitter buffer underrun: frames=%zu, count=%lu",
-                     frame_count, (unsigned long)jitter_buffer->underrun_count);
-            xSemaphoreGive(jitter_buffer->mutex);
-            return 0;  // 返回0表示暂时没有数据，但不是错误
-        }
+/* trace 记录一次被接受的 FIFO 写入，序号为写入次数，depth 为写入前的深度（生产者持锁调用） */
+static inline void s_trace_write(jitter_buffer_t *jb, size_t len, size_t depth)
+{
+    if (jb->trace != NULL) {
+        s_trace(jb, JITTER_TRACE_WRITE, len, jb->trace_write_seq++, depth);
     }
+}
 
-    // 读取数据
-    if (jitter_buffer->config.with_header) {
-        /* 带头格式：先 peek 2 字节大端长度，数据够再整帧读 */
-        if (jitter_buffer->data_size < JITTER_HEADER_LEN) {
-            xSemaphoreGive(jitter_buffer->mutex);
-            return 0;
-        }
-        uint8_t hdr[JITTER_HEADER_LEN];
-        s_ring_peek(jitter_buffer, hdr, JITTER_HEADER_LEN);
-        uint16_t payload_len = (uint16_t)((hdr[0] << 8) | hdr[1]);
-        if (payload_len > jitter_buffer->config.frame_size) {
-            /* frame_size 为 with_header 时单帧 payload 上限 */
-            ESP_LOGW(TAG, "Jitter buffer read: header len=%u > max_payload(%u), skip frame", payload_len, jitter_buffer->config.frame_size);
-            if (jitter_buffer->data_size < JITTER_HEADER_LEN + payload_len) {
-                xSemaphoreGive(jitter_buffer->mutex);
-                return 0;
+/* lock_free：消费者处理生产者发起的 reset，丢弃 reset 之前写入的全部数据 */
+static void s_handle_reset_request(jitter_buffer_t *jb)
+{
+    uint32_t gen = atomic_load(&jb->reset_gen);
+    if (gen == jb->reset_gen_seen) {
+        return;
+    }
+    jb->reset_gen_seen = gen;
+    atomic_store(&jb->sample_pending, false);  /* 被丢弃数据上的采样作废 */
+    size_t mark = atomic_load(&jb->reset_mark);
+    while (jb->total_read != mark) {
+        size_t skip = mark - jb->total_read;
+        if (jb->config.with_header) {
+            size_t payload_len;
+            skip = s_peek_record(jb, 0, skip, &payload_len);
+            if (skip == 0) {
+                break;
             }
-            (void)s_ring_read(jitter_buffer, hdr, JITTER_HEADER_LEN);
-            size_t left = (size_t)payload_len;
-            while (left > 0) {
-                size_t chunk = (left < jitter_buffer->config.frame_size) ? left : jitter_buffer->config.frame_size;
-                (void)s_ring_read(jitter_buffer, jitter_buffer->frame_buffer, chunk);
-                left -= chunk;
+            if (payload_len != SIZE_MAX) {
+                s_frame_removed(jb, 0, skip, payload_len);
             }
-            xSemaphoreGive(jitter_buffer->mutex);
-            return 0;  /* 丢弃整帧，下次从下一帧头对齐 */
         }
-        if (jitter_buffer->data_size < JITTER_HEADER_LEN + payload_len) {
-            xSemaphoreGive(jitter_buffer->mutex);
-            return 0;  /* 整帧未到齐，不消费 */
+        s_ring_skip(jb, skip);
+    }
+}
+
+/* mutex 模式 reset/flush 共用：清空环形缓冲、暂存槽与包槽，作废未提交的预留并结束 drain（调用方需已持有 mutex）
+ * 不把位置归零：输出回调可能仍持有 read_pos 之前的帧，从 read_pos 继续写不会覆盖它 */
+static void s_clear_locked(jitter_buffer_t *jb)
+{
+    jb->write_pos = jb->read_pos;
+    jb->data_size = 0;
+    jb->frame_count = 0;
+    jb->buffered_us = 0;
+    jb->reserved = false;
+    uint8_t expected = JITTER_STAGE_FULL;
+    atomic_compare_exchange_strong(&jb->stage_state, &expected, JITTER_STAGE_EMPTY);
+    jb->last_arrival_us = 0;  /* 抖动估计保留，只重新开始计时 */
+    jb->sample_pending = false;
+    if (jb->slots != NULL) {
+        for (uint32_t i = 0; i < jb->config.packet_slots; i++) {
+            jb->slots[i].valid = false;
         }
-        (void)s_ring_read(jitter_buffer, hdr, JITTER_HEADER_LEN);  /* 跳过 2 字节头 */
-        size_t got = s_ring_read(jitter_buffer, data, (size_t)payload_len);
-        xSemaphoreGive(jitter_buffer->mutex);
-        return (int)got;
+        jb->seq_started = false;
+        jb->seq_played = false;
     }
+    jb->draining = false;
+}
 
-    /* 无头：按固定帧长读 */
-    size_t read_len = (len < jitter_buffer->data_size) ? len : jitter_buffer->data_size;
-    if (read_len == 0) {
-        xSemaphoreGive(jitter_buffer->mutex);
+/* with_header：payload 若从当前 write_pos 写会跨越缓冲末尾，返回需要填充到末尾的字节数，否则返回 0 */
+static size_t s_wrap_pad(jitter_buffer_t *jb, size_t hdr_len, size_t len)
+{
+    size_t payload_pos = s_ring_wrap(jb, jb->write_pos + hdr_len);
+    if (jb->buffer_size - payload_pos >= len) {
         return 0;
     }
-    s_ring_read(jitter_buffer, data, read_len);
-    xSemaphoreGive(jitter_buffer->mutex);
-    return (int)read_len;
+    return jb->buffer_size - jb->write_pos;
 }
 
-jitter_buffer_handle_t jitter_buffer_create(const jitter_buffer_config_t *config)
+/* with_header：payload 已写在 s_frame_payload_pos() 处，写入（填充标记和）帧头并整帧发布（调用方需已持有 mutex） */
+static void s_publish_frame(jitter_buffer_t *jb, size_t pad, size_t hdr_len, size_t len)
 {
-    if (config->frame_interval <= 0) {
-        ESP_LOGE(TAG, "Jitter buffer create: frame_interval <= 0");
-        return NULL;
+    size_t pos = jb->write_pos;
+    if (pad > 0) {
+        static const uint8_t wrap[JITTER_HEADER_LEN] = { JITTER_HEADER_WRAP >> 8, JITTER_HEADER_WRAP & 0xff };
+        /* align_frames 时 write_pos 对齐，末尾至少剩 JITTER_ALIGN 字节 */
+        /* VARINT 的填充标记只需 1 字节（0xFF），末尾可能只剩 1 字节 */
+        s_ring_copy_in(jb, pos, wrap, jb->config.header_format == JITTER_HEADER_VARINT ? 1 : JITTER_HEADER_LEN);
+        pos = 0;
     }
-    if (config->audio_format_id == AUDIO_FORMAT_ID_OPUS && config->output_silence_on_empty) {
-        if (config->frame_interval != 20 && config->frame_interval != 40 && config->frame_interval != 60 && config->frame_interval != 120) {
-            ESP_LOGE(TAG, "Jitter buffer create: frame_interval is not supported for OPUS format");
-            return NULL;
-        }
+    uint8_t hdr[JITTER_ALIGN];
+    s_header_encode(jb, len, hdr_len, hdr);
+    s_ring_copy_in(jb, pos, hdr, hdr_len);
+    /* 时长先于数据计入，消费者出队时不会减到负数 */
+    atomic_fetch_add(&jb->buffered_us, s_ring_opus_us(jb, s_ring_wrap(jb, pos + hdr_len), len));
+    /* 填充、头与 payload 一次发布，消费者不会看到只有头的半帧 */
+    s_ring_publish(jb, pad + hdr_len + s_record_payload(jb, len));
+    jb->frame_count++;
+}
+
+/* with_header：帧 payload 的写入位置，pad 为 s_wrap_pad() 的结果 */
+static inline size_t s_frame_payload_pos(jitter_buffer_t *jb, size_t pad, size_t hdr_len)
+{
+    return pad > 0 ? hdr_len : s_ring_wrap(jb, jb->write_pos + hdr_len);
+}
+
+/* 为 need 字节腾出空间（调用方需已持有 mutex）
+ * lock_free 模式下生产者不能移动 read_pos，空间不足时返回 ESP_ERR_NO_MEM 由调用方丢弃新帧 */
+static esp_err_t s_make_room(jitter_buffer_t *jitter_buffer, size_t write_len)
+{
+    size_t capacity = jitter_buffer->buffer_size - atomic_load(&jitter_buffer->borrowed);
+    if (write_len > capacity) {
+        ESP_LOGW(TAG, "Jitter buffer write: len=%zu exceeds buffer_size=%zu", write_len, jitter_buffer->buffer_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t available_space = capacity - atomic_load(&jitter_buffer->data_size);
+    if (write_len <= available_space) {
+        return ESP_OK;
+    }
+    if (jitter_buffer->config.lock_free || jitter_buffer->config.overrun_policy == JITTER_OVERRUN_DROP_NEWEST) {
+        jitter_buffer->overrun_count++;
+        jitter_buffer->discard_count++;
+        jitter_buffer->drop_newest_count++;
+        s_defer(jitter_buffer, JITTER_DEFER_LOG_DROP_NEWEST, (uint32_t)write_len, jitter_buffer->overrun_count);
+        return ESP_ERR_NO_MEM;
+    }
+    if (jitter_buffer->config.with_header) {
+        /* 带头格式必须按整帧丢弃，否则 read_pos 会错位，后续会把 payload 当长度解析 */
+        size_t discarded_frames = 0;
+        while (available_space < write_len) {
+            size_t payload_len;
+            size_t rec_len = s_peek_record(jitter_buffer, 0, jitter_buffer->data_size, &payload_len);
+            if (rec_len == 0) {
+                break;
+            }
+            if (payload_len != SIZE_MAX) {
+                if (payload_len > jitter_buffer->buffer_size / 2) {
+                    break;
+                }
+                s_frame_removed(jitter_buffer, 0, rec_len, payload_len);
+                discarded_frames++;
+            }
+            s_ring_drop(jitter_buffer, rec_len);
+            available_space = capacity - jitter_buffer->data_size;
+        }
+        if (available_space < write_len) {
+            size_t discard = write_len - available_space;
+            if (discard > jitter_buffer->data_size) {
+                discard = jitter_buffer->data_size;
+            }
+            s_ring_drop(jitter_buffer, discard);
+            /* 对齐已丢失，重新解析剩余数据以校正帧计数 */
+            jitter_buffer->frame_count = s_get_frame_count_with_header(jitter_buffer);
+            s_defer(jitter_buffer, JITTER_DEFER_LOG_ALIGN_LOST, (uint32_t)discard, 0);
+        }
+        jitter_buffer->overrun_count++;
+        jitter_buffer->discard_count += discarded_frames;
+        jitter_buffer->drop_oldest_count += discarded_frames;
+        if (discarded_frames > 0) {
+            s_defer(jitter_buffer, JITTER_DEFER_LOG_DROP_OLDEST, (uint32_t)discarded_frames, jitter_buffer->overrun_count);
+        }
+    } else {
+        /* 按整帧丢弃，保持 read_pos 帧（及采样）对齐 */
+        size_t frame_size = jitter_buffer->config.frame_size;
+        size_t discard = (write_len - available_space + frame_size - 1) / frame_size * frame_size;
+        if (discard > jitter_buffer->data_size) {
+            discard = jitter_buffer->data_size;
+        }
+        s_ring_drop(jitter_buffer, discard);
+        size_t discarded_frames = (discard + frame_size - 1) / frame_size;
+        jitter_buffer->overrun_count++;
+        jitter_buffer->discard_count += discarded_frames;
+        jitter_buffer->drop_oldest_count += discarded_frames;
+        s_defer(jitter_buffer, JITTER_DEFER_LOG_DROP_OLDEST, (uint32_t)discarded_frames, jitter_buffer->overrun_count);
+    }
+    if (jitter_buffer->config.overrun_policy == JITTER_OVERRUN_COMPRESS) {
+        jitter_buffer->compressing = true;
+    }
+    return ESP_OK;
+}
+
+/* 生效水位恢复为配置值；adaptive_delay 时限制在 [min_high_water, max_high_water] 内并按目标初始化抖动估计 */
+static void s_water_init(jitter_buffer_t *jb)
+{
+    const jitter_buffer_config_t *config = &jb->config;
+    jb->high_water = config->high_water;
+    jb->low_water = config->low_water;
+    jb->jitter_q4 = 0;
+    if (config->adaptive_delay) {
+        /* 初始目标取配置值并限制在 [min_high_water, max_high_water] 内，之后随抖动调整 */
+        if (jb->high_water < config->min_high_water) {
+            jb->high_water = config->min_high_water;
+        } else if (jb->high_water > config->max_high_water) {
+            jb->high_water = config->max_high_water;
+        }
+        /* 抖动估计从与初始目标相符的值开始，避免首包把高水位拉到最低 */
+        jb->jitter_q4 = (uint32_t)(((uint64_t)(jb->high_water - 1) * config->frame_interval * 1000 / JITTER_ADAPT_K) << 4);
+    }
+}
+
+/* adaptive_delay：记录一次到达并更新抖动估计与目标水位（生产者侧，调用方需已持有 mutex）
+ * frame_us 为本次写入的播放时长，即到下一次写入前发送端时钟应前进的时间；
+ * 包模式下发送时钟由序号给出，调用方预先设置 expected_us 并传入 0 */
+static void s_adapt_on_arrival(jitter_buffer_t *jb, int64_t frame_us)
+{
+    if (!jb->config.adaptive_delay) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t interval_us = (int64_t)jb->config.frame_interval * 1000;
+    if (jb->last_arrival_us != 0) {
+        /* RFC 3550 6.4.1：D 为到达间隔与发送间隔之差，J += (|D| - J) / 16 */
+        int64_t d = (now - jb->last_arrival_us) - jb->expected_us;
+        if (d < 0) {
+            d = -d;
+        }
+        int64_t d_max = (int64_t)jb->config.max_high_water * interval_us;
+        if (d > d_max) {
+            d = d_max;  /* 长时间停顿（如对端静音）不应让估计失控 */
+        }
+        jb->jitter_q4 += (uint32_t)d - (jb->jitter_q4 >> 4);
+        jb->expected_us = 0;
+    }
+    jb->last_arrival_us = now;
+    jb->expected_us += frame_us;
+
+    uint32_t jitter_us = jb->jitter_q4 >> 4;
+    uint32_t target = (uint32_t)((JITTER_ADAPT_K * (int64_t)jitter_us + interval_us - 1) / interval_us) + 1;
+    if (target < jb->config.min_high_water) {
+        target = jb->config.min_high_water;
+    } else if (target > jb->config.max_high_water) {
+        target = jb->config.max_high_water;
+    }
+    if (target != atomic_load(&jb->high_water)) {
+        /* 低水位按配置比例随高水位缩放 */
+        uint32_t low = (uint32_t)((uint64_t)jb->config.low_water * target / jb->config.high_water);
+        if (low == 0 && jb->config.low_water > 0) {
+            low = 1;
+        }
+        atomic_store(&jb->low_water, low);
+        atomic_store(&jb->high_water, target);
+        ESP_LOGD(TAG, "Jitter buffer adaptive: jitter=%luus, high_water=%lu, low_water=%lu",
+                 (unsigned long)jitter_us, (unsigned long)target, (unsigned long)low);
+    }
+}
+
+/* 一次 FIFO 写入按 frame_interval 折算的播放时长（微秒）；opus_duration 时按 data 的 TOC 解析，data 为 NULL 或空包按一拍计 */
+static inline int64_t s_write_duration_us(jitter_buffer_t *jb, const uint8_t *data, size_t len)
+{
+    int64_t interval_us = (int64_t)jb->config.frame_interval * 1000;
+    if (jb->config.opus_duration && data != NULL && len > 0) {
+        uint32_t us = s_opus_duration_us(data[0], len > 1 ? data[1] : 0, len);
+        return us > 0 ? us : interval_us;
+    }
+    if (jb->config.with_header) {
+        return interval_us;
+    }
+    return interval_us * (int64_t)len / jb->config.frame_size;
+}
+
+/* adaptive_delay：帧能量是否足够低，丢弃时不易察觉 */
+static bool s_frame_is_quiet(jitter_buffer_t *jb, const jitter_buffer_output_frame_t *frame)
+{
+    if (jb->config.audio_format_id == AUDIO_FORMAT_ID_OPUS) {
+        return frame->len + frame->len2 <= JITTER_ADAPT_QUIET_OPUS;
+    }
+    const uint8_t *seg[2] = { frame->data, frame->data2 };
+    size_t seg_len[2] = { frame->len, frame->len2 };
+    for (int i = 0; i < 2; i++) {
+        for (size_t off = 0; off + sizeof(int16_t) <= seg_len[i]; off += sizeof(int16_t)) {
+            int16_t sample;
+            memcpy(&sample, seg[i] + off, sizeof(sample));
+            if (sample >= JITTER_ADAPT_QUIET_PCM || sample <= -JITTER_ADAPT_QUIET_PCM) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* JITTER_OVERRUN_COMPRESS：overrun 之后每 compress_interval 帧丢弃一帧，深度回到 high_water 时停止 */
+static bool s_compress_should_drop(jitter_buffer_t *jb, size_t frame_count)
+{
+    if (!jb->compressing) {
+        return false;
+    }
+    if (frame_count <= atomic_load(&jb->high_water)) {
+        jb->compressing = false;
+        jb->compress_ticks = 0;
+        return false;
+    }
+    if (++jb->compress_ticks < jb->config.compress_interval) {
+        return false;
+    }
+    jb->compress_ticks = 0;
+    jb->compress_count++;
+    return true;
+}
+
+/* adaptive_delay：深度超出目标时逐步丢帧收缩延迟，优先丢弃低能量帧（仅消费者，PLAYING 状态） */
+static bool s_adapt_should_drop(jitter_buffer_t *jb, size_t frame_count, const jitter_buffer_output_frame_t *frame)
+{
+    if (!jb->config.adaptive_delay || frame_count <= atomic_load(&jb->high_water) + 1) {
+        jb->shrink_wait = 0;
+        return false;
+    }
+    jb->shrink_wait++;
+    if (jb->shrink_wait < JITTER_ADAPT_DROP_GAP) {
+        return false;
+    }
+    if (jb->shrink_wait < JITTER_ADAPT_FORCE_TICKS && !s_frame_is_quiet(jb, frame)) {
+        return false;
+    }
+    jb->shrink_wait = 0;
+    jb->adapt_drop_count++;
+    return true;
+}
+
+/* 起播门限：start/reset 之后的首次蓄水只需 start_water 帧，欠载后的重新蓄水仍需 high_water */
+static inline uint32_t s_start_water(jitter_buffer_t *jb, jitter_buffer_state_t state)
+{
+    if (state == JITTER_STATE_BUFFERING && atomic_load(&jb->fast_start)) {
+        return jb->config.start_water;
+    }
+    return atomic_load(&jb->high_water);
+}
+
+/* 欠载门限：快速起播后深度尚未长到 high_water 时，low_water 按已达到的深度等比缩小 */
+static inline uint32_t s_low_water(jitter_buffer_t *jb)
+{
+    uint32_t low = atomic_load(&jb->low_water);
+    if (atomic_load(&jb->fast_start)) {
+        uint32_t scaled = (uint32_t)((uint64_t)low * atomic_load(&jb->ramp_depth) / atomic_load(&jb->high_water));
+        if (scaled == 0 && low > 0) {
+            scaled = 1;  /* 缓冲读空仍按欠载处理 */
+        }
+        return scaled < low ? scaled : low;
+    }
+    return low;
+}
+
+/* flush 后恢复播放的深度：start_water，未配置时为 low_water（至少 1 帧） */
+static inline uint32_t s_flush_resume(jitter_buffer_t *jb)
+{
+    uint32_t resume = jb->config.start_water > 0 ? jb->config.start_water : atomic_load(&jb->low_water);
+    return resume > 0 ? resume : 1;
+}
+
+/* 消费者处理 flush：丢弃被清空数据的隐藏帧与漂移估计，lock_free 模式下此时数据才真正丢弃，在此发 FLUSHED */
+static void s_handle_flush_request(jitter_buffer_t *jb)
+{
+    uint32_t gen = atomic_load(&jb->flush_gen);
+    if (gen == jb->flush_gen_seen) {
+        return;
+    }
+    jb->flush_gen_seen = gen;
+    jb->prev_len = 0;
+    jb->conceal_count = 0;
+    jb->drift_valid = false;
+    if (jb->config.lock_free) {
+        s_defer(jb, JITTER_DEFER_EVENT, JITTER_EVENT_FLUSHED, 0);
+    }
+}
+
+/* 写路径末尾：达到高水位开始播放（调用方需已持有 mutex） */
+static void s_check_start_playing(jitter_buffer_t *jitter_buffer)
+{
+    size_t frame_count = s_get_frame_count(jitter_buffer);
+    jitter_buffer_state_t state = atomic_load(&jitter_buffer->state);
+    if (state == JITTER_STATE_BUFFERING || state == JITTER_STATE_UNDERRUN) {
+        if (frame_count >= s_start_water(jitter_buffer, state) &&
+            s_state_transit(jitter_buffer, state, JITTER_STATE_PLAYING)) {
+            atomic_store(&jitter_buffer->ramp_depth, (uint32_t)frame_count);
+            s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_PLAYING, 0);
+            s_defer(jitter_buffer, JITTER_DEFER_LOG_PLAYING, (uint32_t)frame_count, 0);
+        }
+    }
+}
+
+/* drift_compensation：播放中按 EWMA 跟踪深度趋势，欠载/蓄水期间重新开始 */
+static void s_drift_track(jitter_buffer_t *jb)
+{
+    if (atomic_load(&jb->state) != JITTER_STATE_PLAYING) {
+        jb->drift_valid = false;
+        return;
+    }
+    int64_t depth_q4 = (int64_t)atomic_load(&jb->data_size) << 4;
+    if (!jb->drift_valid) {
+        jb->drift_depth_q4 = depth_q4;
+        jb->drift_ticks = 0;
+        jb->drift_valid = true;
+        return;
+    }
+    jb->drift_depth_q4 += (depth_q4 - jb->drift_depth_q4) >> JITTER_DRIFT_SMOOTH_SHIFT;
+}
+
+static inline size_t s_drift_stride(jitter_buffer_t *jb)
+{
+    return (jb->config.pcm_channels > 0 ? jb->config.pcm_channels : 1) * sizeof(int16_t);
+}
+
+/* 本拍应从缓冲读取的字节数：需要加快时多读一个采样帧再删除，需要放慢时少读一个再插入，输出仍为 frame_size
+ * step 返回 -1 删除、1 插入、0 不校正；cap 为目标缓冲大小 */
+static size_t s_drift_read_len(jitter_buffer_t *jb, size_t cap, int *step)
+{
+    *step = 0;
+    size_t frame_size = jb->config.frame_size;
+    /* 快速起播期间每拍都可校正，尽快把深度拉回 high_water */
+    uint32_t every = atomic_load(&jb->fast_start) ? 1 : JITTER_DRIFT_EVERY;
+    if (!jb->config.drift_compensation || !jb->drift_valid || ++jb->drift_ticks < every) {
+        return frame_size;
+    }
+    jb->drift_ticks = 0;
+    size_t stride = s_drift_stride(jb);
+    int64_t target = (int64_t)atomic_load(&jb->high_water) * frame_size;
+    int64_t error = (jb->drift_depth_q4 >> 4) - target;
+    int64_t deadband = frame_size / 2;
+    if (error > deadband && frame_size + stride <= cap) {
+        *step = -1;
+        return frame_size + stride;
+    }
+    if (error < -deadband && frame_size > stride * 4) {
+        *step = 1;
+        return frame_size - stride;
+    }
+    return frame_size;
+}
+
+/* 在首声道的过零点（找不到时取幅度最小处）插入或删除一个采样帧，返回新长度
+ * 插入需要 cap >= len + 一个采样帧，否则本次不校正 */
+static size_t s_drift_apply(jitter_buffer_t *jb, uint8_t *buf, size_t len, size_t cap, int step)
+{
+    size_t stride = s_drift_stride(jb);
+    size_t n = len / stride;
+    if (step < 0 && len <= jb->config.frame_size) {
+        return len;  /* 缓冲里不足多读的一个采样帧，本拍不删除，输出不短于读到的数据 */
+    }
+    if (step == 0 || len % stride != 0 || n < 4 || (step > 0 && len + stride > cap)) {
+        /* 多读的数据未对齐到采样帧时无法删除，截断到 frame_size，保证输出不超过一帧 */
+        return (step < 0 && len > jb->config.frame_size) ? jb->config.frame_size : len;
+    }
+    size_t best = 1;
+    int32_t best_score = INT32_MAX;
+    int16_t prev;
+    memcpy(&prev, buf, sizeof(prev));
+    for (size_t i = 1; i < n - 1; i++) {
+        int16_t cur;
+        memcpy(&cur, buf + i * stride, sizeof(cur));
+        int32_t score = abs(cur) + (((prev < 0) != (cur < 0)) ? 0 : 65536);
+        if (score < best_score) {
+            best_score = score;
+            best = i;
+        }
+        prev = cur;
+    }
+    if (step < 0) {
+        memmove(buf + best * stride, buf + (best + 1) * stride, (n - best - 1) * stride);
+        jb->drift_deleted++;
+        return len - stride;
+    }
+    memmove(buf + (best + 1) * stride, buf + best * stride, (n - best) * stride);
+    jb->drift_inserted++;
+    return len + stride;
+}
+
+/* 本拍无数据时输出的静音帧 */
+static void s_get_silence(jitter_buffer_t *jitter_buffer, const uint8_t **data, size_t *len)
+{
+    if (jitter_buffer->config.audio_format_id == AUDIO_FORMAT_ID_OPUS) {
+        /* opus_silence 依次为 20/40/60/120 ms */
+        uint32_t interval = jitter_buffer->config.frame_interval;
+        int index = (interval == 120) ? 3 : (int)(interval / 20) - 1;
+        *data = opus_silence[index].data;
+        *len = opus_silence[index].len;
+    } else {
+        /* 零拷贝输出且未启用隐藏时 frame_buffer 只用作静音帧，创建后保持全零 */
+        if (jitter_buffer->config.on_output_frame == NULL || jitter_buffer->prev_frame != NULL) {
+            memset(jitter_buffer->frame_buffer, 0, jitter_buffer->config.frame_size);
+        }
+        *data = jitter_buffer->frame_buffer;
+        *len = jitter_buffer->config.frame_size;
+    }
+}
+
+/* 输出一帧：on_output_frame 优先，否则 on_output_data */
+static void s_output(jitter_buffer_t *jitter_buffer, const uint8_t *data, size_t len)
+{
+    JITTER_PROF_BEGIN(JITTER_PROFILE_CALLBACK, t_cb);
+    if (jitter_buffer->config.on_output_frame != NULL) {
+        jitter_buffer_output_frame_t frame = { .data = data, .len = len };
+        jitter_buffer->config.on_output_frame(&frame);
+    } else {
+        jitter_buffer->config.on_output_data(data, len);
+    }
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_CALLBACK, t_cb);
+}
+
+/* 保存最近一次真实输出的帧，供丢包隐藏使用（仅消费者） */
+static void s_conceal_remember(jitter_buffer_t *jitter_buffer, const jitter_buffer_output_frame_t *frame)
+{
+    if (jitter_buffer->prev_frame == NULL) {
+        return;
+    }
+    memcpy(jitter_buffer->prev_frame, frame->data, frame->len);
+    if (frame->len2 > 0) {
+        memcpy(jitter_buffer->prev_frame + frame->len, frame->data2, frame->len2);
+    }
+    jitter_buffer->prev_len = frame->len + frame->len2;
+    jitter_buffer->conceal_count = 0;
+}
+
+/* PCM：重复上一帧并线性淡出，连续第 k 帧的增益从 (N-k)/N 降到 (N-k-1)/N，按 16 位样本处理 */
+static void s_conceal_fade(jitter_buffer_t *jitter_buffer, uint32_t k)
+{
+    const int32_t n = JITTER_CONCEAL_MAX_FRAMES;
+    size_t samples = jitter_buffer->prev_len / sizeof(int16_t);
+    int32_t gain_start = (int32_t)(32768 * (n - (int32_t)k) / n);
+    int32_t gain_end = (int32_t)(32768 * (n - (int32_t)k - 1) / n);
+    for (size_t i = 0; i < samples; i++) {
+        int16_t sample;
+        memcpy(&sample, jitter_buffer->prev_frame + i * sizeof(int16_t), sizeof(sample));
+        int32_t gain = gain_start + (int32_t)((int64_t)(gain_end - gain_start) * (int64_t)i / (int64_t)samples);
+        sample = (int16_t)(((int32_t)sample * gain) >> 15);
+        memcpy(jitter_buffer->frame_buffer + i * sizeof(int16_t), &sample, sizeof(sample));
+    }
+}
+
+/* 本拍无数据时生成隐藏帧；返回 false 表示不做隐藏，按 output_silence_on_empty 处理
+ * 仅在播放开始后、连续不超过 JITTER_CONCEAL_MAX_FRAMES 帧时隐藏，蓄水阶段仍为静音 */
+static bool s_conceal(jitter_buffer_t *jitter_buffer, const uint8_t **data, size_t *len)
+{
+    if (jitter_buffer->prev_frame == NULL || jitter_buffer->prev_len == 0 ||
+        jitter_buffer->conceal_count >= JITTER_CONCEAL_MAX_FRAMES ||
+        atomic_load(&jitter_buffer->state) == JITTER_STATE_BUFFERING) {
+        return false;
+    }
+    uint32_t k = jitter_buffer->conceal_count++;
+    if (jitter_buffer->config.on_conceal != NULL) {
+        size_t n = jitter_buffer->config.on_conceal(jitter_buffer->prev_frame, jitter_buffer->prev_len,
+                                                    jitter_buffer->frame_buffer, jitter_buffer->config.frame_size);
+        if (n == 0 || n > jitter_buffer->config.frame_size) {
+            return false;
+        }
+        *data = jitter_buffer->frame_buffer;
+        *len = n;
+    } else if (jitter_buffer->config.audio_format_id == AUDIO_FORMAT_ID_OPUS) {
+        /* 空包标记：解码器收到 len 为 0 的帧时走自身 PLC/FEC（如 opus_decode(dec, NULL, 0, ...)） */
+        *data = NULL;
+        *len = 0;
+    } else {
+        s_conceal_fade(jitter_buffer, k);
+        *data = jitter_buffer->frame_buffer;
+        *len = jitter_buffer->prev_len;
+    }
+    jitter_buffer->conceal_count_total++;
+    return true;
+}
+
+/* 本拍无数据时的替代帧：丢包隐藏优先，其次静音；返回 false 表示本拍不输出 */
+static bool s_get_empty_frame(jitter_buffer_t *jitter_buffer, const uint8_t **data, size_t *len)
+{
+    if (s_conceal(jitter_buffer, data, len)) {
+        s_trace(jitter_buffer, JITTER_TRACE_OUT_CONCEAL, *len, 0, jitter_buffer->trace_depth);
+        return true;
+    }
+    if (jitter_buffer->config.output_silence_on_empty) {
+        s_get_silence(jitter_buffer, data, len);
+        s_trace(jitter_buffer, JITTER_TRACE_OUT_SILENCE, *len, 0, jitter_buffer->trace_depth);
+        return true;
+    }
+    s_trace(jitter_buffer, JITTER_TRACE_OUT_NONE, 0, 0, jitter_buffer->trace_depth);
+    return false;
+}
+
+/* esp_timer 周期回调：通知播放任务输出一拍 */
+static void s_clock_timer_cb(void *arg)
+{
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)arg;
+    xTaskNotifyGive(jitter_buffer->task_handle);
+}
+
+/* 唤醒等待时钟通知的播放任务，使其处理 STOP/EXIT */
+static inline void s_clock_wake(jitter_buffer_t *jitter_buffer)
+{
+    if ((jitter_buffer->config.clock_source != JITTER_CLOCK_TASK_TICK || jitter_buffer->config.dtx_suspend_ms > 0) &&
+        jitter_buffer->task_handle != NULL) {
+        xTaskNotifyGive(jitter_buffer->task_handle);
+    }
+}
+
+/* dtx_suspend_ms：发送端的静音帧，Opus 为不超过 2 字节的 DTX 包（只有 TOC），PCM 为全零数据 */
+static bool s_dtx_is_silence(jitter_buffer_t *jb, const uint8_t *data, size_t len)
+{
+    if (jb->config.audio_format_id == AUDIO_FORMAT_ID_OPUS) {
+        return len <= 2;
+    }
+    if (data == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* 输出 us 时长后累计连续静音，frame 为 NULL 表示本拍无数据；输出音频时清零（仅消费者） */
+static void s_dtx_note(jitter_buffer_t *jb, const jitter_buffer_output_frame_t *frame, uint32_t us)
+{
+    if (jb->config.dtx_suspend_ms == 0) {
+        return;
+    }
+    bool silent = true;
+    if (frame != NULL) {
+        if (jb->config.audio_format_id == AUDIO_FORMAT_ID_OPUS) {
+            silent = frame->len + frame->len2 <= 2;
+        } else {
+            silent = s_dtx_is_silence(jb, frame->data, frame->len) &&
+                     (frame->len2 == 0 || s_dtx_is_silence(jb, frame->data2, frame->len2));
+        }
+    }
+    if (!silent) {
+        jb->dtx_silence_us = 0;
+    } else if (jb->dtx_silence_us <= UINT32_MAX - us) {
+        jb->dtx_silence_us += us;
+    }
+}
+
+/* 静音持续 dtx_suspend_ms 后挂起节拍；PLAYING 且仍有数据（或有暂存帧）时不挂起
+ * 先置标志再检查数据，与写端“先写数据再检查标志”配对，两边至少一方能看到对方，不会带着待播数据睡眠 */
+static void s_dtx_check_suspend(jitter_buffer_t *jb)
+{
+    if (jb->config.dtx_suspend_ms == 0 || jb->dtx_silence_us < (uint64_t)jb->config.dtx_suspend_ms * 1000) {
+        return;
+    }
+    atomic_store(&jb->dtx_suspended, true);
+    if ((atomic_load(&jb->state) == JITTER_STATE_PLAYING && atomic_load(&jb->data_size) > 0) ||
+        atomic_load(&jb->stage_state) != JITTER_STAGE_EMPTY) {
+        atomic_store(&jb->dtx_suspended, false);
+        return;
+    }
+    jb->dtx_suspends++;
+    s_defer(jb, JITTER_DEFER_EVENT, JITTER_EVENT_SILENCE, 0);
+    ESP_LOGI(TAG, "Jitter buffer: sender silence, playout suspended");
+}
+
+/* 挂起期间等待写端唤醒，之后把 last_wake_time 前移整数拍，下一拍仍落在原节拍相位上
+ * 返回 false 表示被 stop/destroy 唤醒 */
+static bool s_dtx_sleep(jitter_buffer_t *jb)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    atomic_store(&jb->dtx_suspended, false);
+    jb->dtx_silence_us = 0;
+    TickType_t period = pdMS_TO_TICKS(jb->config.frame_interval);
+    if (period > 0) {
+        TickType_t elapsed = xTaskGetTickCount() - jb->last_wake_time;
+        jb->last_wake_time += elapsed - elapsed % period;
+    }
+    return !(xEventGroupGetBits(jb->event_group) & (JITTER_BUFFER_EVENT_STOP | JITTER_BUFFER_EVENT_EXIT));
+}
+
+/* 写入音频后唤醒被挂起的播放任务（调用方已发布数据） */
+static inline void s_dtx_resume(jitter_buffer_t *jb)
+{
+    if (atomic_load(&jb->dtx_suspended) && atomic_exchange(&jb->dtx_suspended, false)) {
+        xTaskNotifyGive(jb->task_handle);
+    }
+}
+
+/* 挂起期间写入的静音帧直接丢弃，不唤醒播放任务 */
+static inline bool s_dtx_drop(jitter_buffer_t *jb, const uint8_t *data, size_t len)
+{
+    if (!atomic_load(&jb->dtx_suspended) || !s_dtx_is_silence(jb, data, len)) {
+        return false;
+    }
+    atomic_fetch_add(&jb->dtx_dropped, 1);
+    return true;
+}
+
+/* 已出队帧的播放时长：opus_duration 时按 TOC 解析，否则（或空包）为一拍 */
+static uint32_t s_frame_duration_us(jitter_buffer_t *jb, const jitter_buffer_output_frame_t *frame)
+{
+    uint32_t interval_us = jb->config.frame_interval * 1000;
+    size_t len = frame->len + frame->len2;
+    if (!jb->config.opus_duration || len == 0) {
+        return interval_us;
+    }
+    const uint8_t *first = frame->len > 0 ? frame->data : frame->data2;
+    uint8_t count_byte = 0;
+    if (len > 1) {
+        count_byte = frame->len > 1 ? frame->data[1] : (frame->len == 1 ? frame->data2[0] : frame->data2[1]);
+    }
+    uint32_t us = s_opus_duration_us(first[0], count_byte, len);
+    return us > 0 ? us : interval_us;
+}
+
+/* reconfigure：把缓冲内的帧按序线性拷贝到新环形缓冲开头并换入，放不下时丢弃最旧的帧（调用方需已持有 mutex）
+ * with_header 时跳过对齐填充、按最短帧头重新编码，超过新 frame_size 的帧丢弃；无头时按旧帧长整帧丢弃 */
+static void s_reconfig_migrate(jitter_buffer_t *jb, jitter_reconfig_t *rc)
+{
+    size_t data_size = atomic_load(&jb->data_size);
+    size_t wpos = 0;
+    if (jb->config.with_header) {
+        /* 第一遍统计保留帧的总长，第二遍跳过放不下的最旧帧后逐帧拷贝 */
+        size_t total = 0;
+        size_t offset = 0;
+        size_t payload_len;
+        size_t rec_len;
+        for (; (rec_len = s_peek_record(jb, offset, data_size - offset, &payload_len)) > 0; offset += rec_len) {
+            if (payload_len != SIZE_MAX && payload_len <= rc->want.frame_size) {
+                total += s_header_len(jb, payload_len) + s_record_payload(jb, payload_len);
+            }
+        }
+        for (offset = 0; (rec_len = s_peek_record(jb, offset, data_size - offset, &payload_len)) > 0; offset += rec_len) {
+            if (payload_len == SIZE_MAX) {
+                continue;
+            }
+            size_t hdr_len = s_header_len(jb, payload_len);
+            size_t new_len = hdr_len + s_record_payload(jb, payload_len);
+            if (payload_len > rc->want.frame_size || total > rc->buffer_size) {
+                if (payload_len <= rc->want.frame_size) {
+                    total -= new_len;
+                }
+                rc->dropped++;
+                continue;
+            }
+            uint8_t hdr[JITTER_ALIGN];
+            s_header_encode(jb, payload_len, hdr_len, hdr);
+            memcpy(rc->buffer + wpos, hdr, hdr_len);
+            s_ring_copy_out(jb, s_ring_wrap(jb, jb->read_pos + offset + rec_len - s_record_payload(jb, payload_len)),
+                            rc->buffer + wpos + hdr_len, payload_len);
+            wpos += new_len;
+            rc->kept++;
+        }
+    } else {
+        size_t frame_size = jb->config.frame_size;
+        size_t skip = 0;
+        if (data_size > rc->buffer_size) {
+            skip = (data_size - rc->buffer_size + frame_size - 1) / frame_size * frame_size;
+            if (skip > data_size) {
+                skip = data_size;
+            }
+            rc->dropped = (uint32_t)((skip + frame_size - 1) / frame_size);
+        }
+        wpos = data_size - skip;
+        if (wpos > 0) {
+            s_ring_copy_out(jb, s_ring_wrap(jb, jb->read_pos + skip), rc->buffer, wpos);
+        }
+        rc->kept = (uint32_t)(wpos / frame_size);
+    }
+
+    uint8_t *old = jb->buffer;
+    jb->buffer = rc->buffer;
+    jb->buffer_size = rc->buffer_size;
+    jb->buffer_mask = rc->buffer_mask;
+    rc->buffer = old;
+    jb->read_pos = 0;
+    jb->write_pos = s_ring_wrap(jb, wpos);
+    jb->data_size = wpos;
+    if (jb->config.with_header) {
+        jb->frame_count = s_get_frame_count_with_header(jb);
+    }
+    atomic_store(&jb->sample_pending, false);  /* 被采样帧已移动或丢弃 */
+    jb->discard_count += rc->dropped;
+}
+
+/* reconfigure：换入新缓冲与配置，水位改变时按新配置重新初始化（调用方需已持有 mutex） */
+static void s_reconfig_apply(jitter_buffer_t *jb, jitter_reconfig_t *rc)
+{
+    const jitter_buffer_reconfig_t *want = &rc->want;
+    jitter_buffer_config_t *config = &jb->config;
+    bool frame_changed = want->frame_size != config->frame_size;
+    bool water_changed = want->high_water != config->high_water || want->low_water != config->low_water ||
+                         want->min_high_water != config->min_high_water || want->max_high_water != config->max_high_water;
+    if (rc->buffer != NULL) {
+        s_reconfig_migrate(jb, rc);
+    }
+    config->buffer_size = want->buffer_size;
+    config->frame_size = want->frame_size;
+    config->high_water = want->high_water;
+    config->low_water = want->low_water;
+    config->min_high_water = want->min_high_water;
+    config->max_high_water = want->max_high_water;
+    if (rc->frame_buffer != NULL) {
+        uint8_t *old = jb->frame_buffer;
+        jb->frame_buffer = rc->frame_buffer;
+        jb->frame_buffer_size = rc->frame_buffer_size;
+        rc->frame_buffer = old;
+    }
+    if (rc->prev_frame != NULL) {
+        uint8_t *old = jb->prev_frame;
+        jb->prev_frame = rc->prev_frame;
+        rc->prev_frame = old;
+    }
+    if (rc->stage != NULL) {
+        uint8_t *old = jb->stage;
+        jb->stage = rc->stage;
+        rc->stage = old;
+    }
+    if (frame_changed) {
+        /* 隐藏帧与漂移的深度估计按旧帧长，丢弃 */
+        jb->prev_len = 0;
+        jb->conceal_count = 0;
+        jb->drift_valid = false;
+    }
+    if (water_changed) {
+        s_water_init(jb);
+    }
+    /* 正在播放时不重新蓄水：深度低于新 high_water 时按快速起播的方式运行，低水位随深度等比放宽 */
+    uint32_t frame_count = (uint32_t)s_get_frame_count(jb);
+    if (atomic_load(&jb->state) == JITTER_STATE_PLAYING && frame_count + 1 < atomic_load(&jb->high_water)) {
+        atomic_store(&jb->ramp_depth, frame_count);
+        atomic_store(&jb->fast_start, true);
+    }
+}
+
+/* 消费者在一拍开始时处理 jitter_buffer_reconfigure()：此时没有借出的帧，frame_buffer 等仅消费者使用的缓冲也空闲
+ * 有未提交的预留或 write_nb 正在填充暂存槽时留到下一拍；暂存槽置为 FILLING 期间写端不会使用它
+ * 只尝试一次加锁，写端持锁时同样留到下一拍，本拍随后取帧的等锁仍只有 read_timeout_ms */
+static void s_handle_reconfig_request(jitter_buffer_t *jb)
+{
+    jitter_reconfig_t *rc = atomic_load(&jb->reconfig);
+    if (rc == NULL || !s_lock(jb, 0)) {
+        return;
+    }
+    s_stage_merge(jb);
+    uint8_t expected = JITTER_STAGE_EMPTY;
+    if (jb->reserved || !atomic_compare_exchange_strong(&jb->stage_state, &expected, JITTER_STAGE_FILLING)) {
+        s_unlock(jb);
+        return;
+    }
+    /* 调用方等待超时会撤回请求，取得请求后由本方完成 */
+    if (atomic_compare_exchange_strong(&jb->reconfig, &rc, NULL)) {
+        s_reconfig_apply(jb, rc);
+        atomic_store(&rc->done, true);
+    }
+    atomic_store(&jb->stage_state, JITTER_STAGE_EMPTY);
+    s_unlock(jb);
+}
+
+/* 输出一帧：取一帧交给输出回调，无数据时做丢包隐藏或输出静音；返回本次输出占用的播放时长（微秒）
+ * fill_empty 为 false 时无数据不输出任何内容并返回 0（opus_duration 一拍内已输出过包） */
+static uint32_t s_jitter_buffer_output_one(jitter_buffer_t *jitter_buffer, bool fill_empty)
+{
+    uint32_t interval_us = jitter_buffer->config.frame_interval * 1000;
+    jitter_buffer_output_frame_t frame;
+    int read_len;
+    int step;
+    size_t want = s_drift_read_len(jitter_buffer, jitter_buffer->frame_buffer_size, &step);
+    if (jitter_buffer->config.on_output_frame != NULL && step == 0) {
+        /* 零拷贝：直接交出环形缓冲内存，回调返回后释放该帧 */
+        read_len = s_jitter_buffer_acquire(jitter_buffer, want, &frame);
+        if (read_len > 0) {
+            s_conceal_remember(jitter_buffer, &frame);
+            s_trace(jitter_buffer, JITTER_TRACE_OUT_FRAME, frame.len + frame.len2, 0, jitter_buffer->trace_depth);
+            uint32_t us = s_frame_duration_us(jitter_buffer, &frame);
+            s_dtx_note(jitter_buffer, &frame, us);
+            JITTER_PROF_BEGIN(JITTER_PROFILE_CALLBACK, t_cb);
+            jitter_buffer->config.on_output_frame(&frame);
+            JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_CALLBACK, t_cb);
+            s_jitter_buffer_release(jitter_buffer);
+            return us;
+        }
+    } else {
+        /* 漂移校正需要改写帧内容，零拷贝输出的这一帧也经 frame_buffer 拷贝 */
+        read_len = s_jitter_buffer_read(jitter_buffer, jitter_buffer->frame_buffer, want);
+        if (read_len > 0) {
+            memset(&frame, 0, sizeof(frame));
+            frame.data = jitter_buffer->frame_buffer;
+            frame.len = s_drift_apply(jitter_buffer, jitter_buffer->frame_buffer, (size_t)read_len,
+                                      jitter_buffer->frame_buffer_size, step);
+            s_conceal_remember(jitter_buffer, &frame);
+            s_trace(jitter_buffer, JITTER_TRACE_OUT_FRAME, frame.len, 0, jitter_buffer->trace_depth);
+            uint32_t us = s_frame_duration_us(jitter_buffer, &frame);
+            s_dtx_note(jitter_buffer, &frame, us);
+            s_output(jitter_buffer, frame.data, frame.len);
+            return us;
+        }
+    }
+    if (read_len != 0 && read_len != JITTER_READ_GAP) {
+        return interval_us;
+    }
+    if (!fill_empty) {
+        return 0;
+    }
+
+    const uint8_t *data;
+    size_t len;
+    s_dtx_note(jitter_buffer, NULL, interval_us);
+    if (s_get_empty_frame(jitter_buffer, &data, &len)) {
+        s_output(jitter_buffer, data, len);
+    }
+    return interval_us;
+}
+
+/* 一拍的输出；opus_duration 时每拍累积 frame_interval 的时长，按包的实际时长输出 0~N 个包
+ * 例如 20 ms 节拍下 40 ms 的包每两拍输出一个，10 ms 的包每拍输出两个
+ * 只有本拍一个包都没有时才输出静音或隐藏帧；已输出过包后读空则停止，剩余额度（不超过一拍）留到下一拍 */
+static void s_jitter_buffer_output(jitter_buffer_t *jitter_buffer)
+{
+    s_handle_reconfig_request(jitter_buffer);
+    JITTER_PROF_BEGIN(JITTER_PROFILE_TICK, t_tick);
+    if (!jitter_buffer->config.opus_duration) {
+        s_jitter_buffer_output_one(jitter_buffer, true);
+    } else {
+        int32_t interval_us = (int32_t)(jitter_buffer->config.frame_interval * 1000);
+        bool produced = false;
+        /* reset/flush 后不沿用旧流的额度，欠下的时长不会拖延新流的播放 */
+        uint32_t gen = atomic_load(&jitter_buffer->reset_gen) + atomic_load(&jitter_buffer->flush_gen);
+        if (gen != jitter_buffer->pace_gen_seen) {
+            jitter_buffer->pace_gen_seen = gen;
+            jitter_buffer->pace_credit_us = 0;
+        }
+        jitter_buffer->pace_credit_us += interval_us;
+        while (jitter_buffer->pace_credit_us > 0) {
+            uint32_t us = s_jitter_buffer_output_one(jitter_buffer, !produced);
+            if (us == 0) {
+                if (jitter_buffer->pace_credit_us > interval_us) {
+                    jitter_buffer->pace_credit_us = interval_us;
+                }
+                break;
+            }
+            jitter_buffer->pace_credit_us -= (int32_t)us;
+            produced = true;
+        }
+    }
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_TICK, t_tick);
+}
+
+/* 拉模式的一拍：与 s_jitter_buffer_output_one() 相同，但帧拷贝到调用方缓冲 */
+static esp_err_t s_jitter_buffer_pull_one(jitter_buffer_t *jitter_buffer, uint8_t *out, size_t max_len, size_t *out_len)
+{
+    *out_len = 0;
+    int step;
+    size_t want = s_drift_read_len(jitter_buffer, max_len, &step);
+    int read_len = s_jitter_buffer_read(jitter_buffer, out, want);
+    if (read_len > 0) {
+        jitter_buffer_output_frame_t frame = { .data = out };
+        frame.len = s_drift_apply(jitter_buffer, out, (size_t)read_len, max_len, step);
+        s_conceal_remember(jitter_buffer, &frame);
+        s_trace(jitter_buffer, JITTER_TRACE_OUT_FRAME, frame.len, 0, jitter_buffer->trace_depth);
+        *out_len = frame.len;
+        return ESP_OK;
+    }
+    if (read_len == JITTER_READ_TIMEOUT) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (read_len != 0 && read_len != JITTER_READ_GAP) {
+        return ESP_FAIL;
+    }
+
+    const uint8_t *data;
+    size_t len;
+    if (!s_get_empty_frame(jitter_buffer, &data, &len)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (len > max_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (len > 0) {
+        memcpy(out, data, len);
+    }
+    *out_len = len;
+    return ESP_OK;
+}
+
+static esp_err_t s_jitter_buffer_pull(jitter_buffer_t *jitter_buffer, uint8_t *out, size_t max_len, size_t *out_len)
+{
+    s_handle_reconfig_request(jitter_buffer);
+    JITTER_PROF_BEGIN(JITTER_PROFILE_TICK, t_tick);
+    esp_err_t ret = s_jitter_buffer_pull_one(jitter_buffer, out, max_len, out_len);
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_TICK, t_tick);
+    return ret;
+}
+
+static esp_err_t s_jitter_buffer_process(jitter_buffer_t *jitter_buffer)
+{
+    if (jitter_buffer->config.clock_source == JITTER_CLOCK_TASK_TICK) {
+        if (atomic_load(&jitter_buffer->dtx_suspended) && !s_dtx_sleep(jitter_buffer)) {
+            return ESP_OK;
+        }
+        vTaskDelayUntil(&jitter_buffer->last_wake_time, pdMS_TO_TICKS(jitter_buffer->config.frame_interval));
+    } else {
+        /* 每个通知对应一拍；不清零计数，积压的拍逐一补上 */
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        /* stop/destroy 也会通知以唤醒任务，此时不输出 */
+        if (xEventGroupGetBits(jitter_buffer->event_group) & (JITTER_BUFFER_EVENT_STOP | JITTER_BUFFER_EVENT_EXIT)) {
+            return ESP_OK;
+        }
+    }
+    s_jitter_buffer_output(jitter_buffer);
+    s_dtx_check_suspend(jitter_buffer);
+    s_defer_flush(jitter_buffer);
+    return ESP_OK;
+}
+
+void jitter_buffer_priv_tick(jitter_buffer_handle_t handle)
+{
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    if (atomic_load(&jitter_buffer->active)) {
+        s_jitter_buffer_output(jitter_buffer);
+        s_defer_flush(jitter_buffer);
+    }
+}
+
+esp_err_t jitter_buffer_priv_pull(jitter_buffer_handle_t handle, uint8_t *out, size_t max_len, size_t *out_len)
+{
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    *out_len = 0;
+    if (!atomic_load(&jitter_buffer->active)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = s_jitter_buffer_pull(jitter_buffer, out, max_len, out_len);
+    s_defer_flush(jitter_buffer);
+    return ret;
+}
+
+void jitter_buffer_priv_recycle(jitter_buffer_handle_t handle)
+{
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    if (atomic_load(&jb->active)) {
+        jitter_buffer_stop(handle);
+    }
+    /* 未换入的 reconfigure 请求撤回；置 aborted 后调用方即可返回并释放 rc，之后不再访问 */
+    jitter_reconfig_t *rc = atomic_exchange(&jb->reconfig, NULL);
+    if (rc != NULL) {
+        atomic_store(&rc->aborted, true);
+    }
+    /* 已停止，消费者不再运行：清空缓冲与统计，水位、隐藏、漂移等播放状态恢复为刚创建时
+     * 不经 jitter_buffer_reset()，归还池中的实例不应再发 BUFFERING 事件 */
+    jitter_buffer_reset_stats(handle);
+    if (!s_lock(jb, pdMS_TO_TICKS(JITTER_LOCK_TIMEOUT_MS))) {
+        ESP_LOGW(TAG, "Jitter buffer recycle: mutex timeout");
+        return;
+    }
+    if (jb->config.lock_free) {
+        atomic_store(&jb->reset_mark, jb->total_written);
+        atomic_fetch_add(&jb->reset_gen, 1);
+        s_handle_reset_request(jb);
+    } else {
+        s_clear_locked(jb);
+    }
+    jb->fast_start = jb->config.start_water > 0;
+    jb->flush_hold = false;
+    jb->draining = false;
+    s_water_init(jb);
+    jb->last_arrival_us = 0;
+    jb->shrink_wait = 0;
+    jb->prev_len = 0;
+    jb->conceal_count = 0;
+    jb->drift_valid = false;
+    jb->compressing = false;
+    jb->pace_credit_us = 0;
+    jb->dtx_silence_us = 0;
+    atomic_store(&jb->dtx_suspended, false);
+    atomic_store(&jb->ramp_depth, 0);
+    portENTER_CRITICAL(&jb->trace_lock);
+    jb->trace_start = 0;
+    jb->trace_count = 0;
+    jb->trace_lost = 0;
+    jb->trace_write_seq = 0;
+    portEXIT_CRITICAL(&jb->trace_lock);
+    atomic_store(&jb->state, JITTER_STATE_IDLE);
+    s_unlock(jb);
+    s_defer_flush(jb);
+}
+
+void jitter_buffer_priv_set_pooled(jitter_buffer_handle_t handle)
+{
+    ((jitter_buffer_t *)handle)->pooled = true;
+}
+
+void jitter_buffer_priv_task_create(TaskFunction_t fn, const char *name, void *arg, uint32_t stack, uint32_t prio,
+                                    int core, uint32_t stack_caps, TaskHandle_t *handle, bool *with_caps)
+{
+    *handle = NULL;
+    *with_caps = false;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+#if defined(CONFIG_SPIRAM_BOOT_INIT)
+    if (stack_caps == 0) {
+        stack_caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    }
+#endif  /* defined(CONFIG_SPIRAM_BOOT_INIT) */
+    if (stack_caps != 0) {
+        xTaskCreatePinnedToCoreWithCaps(fn, name, stack, arg, prio, handle, core, stack_caps);
+        *with_caps = *handle != NULL;
+        return;
+    }
+#else
+    if (stack_caps != 0) {
+        ESP_LOGW(TAG, "%s: task_stack_caps needs configSUPPORT_STATIC_ALLOCATION, using the default stack", name);
+    }
+#endif  /* (configSUPPORT_STATIC_ALLOCATION == 1) */
+    xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, core);
+}
+
+void jitter_buffer_priv_task_exit(bool with_caps)
+{
+    if (with_caps) {
+        /* vTaskDelete() 不释放 WithCaps 分配的栈与 TCB，挂起等待 destroy 以 vTaskDeleteWithCaps() 删除 */
+        vTaskSuspend(NULL);
+    }
+    vTaskDelete(NULL);
+}
+
+void jitter_buffer_priv_task_delete(TaskHandle_t handle, bool with_caps)
+{
+    if (!with_caps || handle == NULL) {
+        return;
+    }
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    /* 退出信号在挂起之前发出，确认任务已挂起（不在另一个核上运行）后才能释放它的栈 */
+    TickType_t start = xTaskGetTickCount();
+    while (eTaskGetState(handle) != eSuspended) {
+        if (xTaskGetTickCount() - start > pdMS_TO_TICKS(JITTER_TASK_EXIT_WAIT_MS)) {
+            ESP_LOGW(TAG, "Jitter buffer: task did not exit, its stack is not freed");
+            return;
+        }
+        vTaskDelay(1);
+    }
+    vTaskDeleteWithCaps(handle);
+#endif  /* (configSUPPORT_STATIC_ALLOCATION == 1) */
+}
+
+static void jitter_buffer_task(void *arg)
+{
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)arg;
+    jitter_buffer->running = true;
+    while (jitter_buffer->running) {
+        EventBits_t bits = xEventGroupWaitBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START | JITTER_BUFFER_EVENT_EXIT, pdTRUE, pdFALSE, portMAX_DELAY);
+        if (bits & JITTER_BUFFER_EVENT_EXIT) {
+            ESP_LOGI(TAG, "Jitter buffer task exit");
+            break;
+        }
+        xEventGroupSetBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START);
+        if (bits & JITTER_BUFFER_EVENT_START) {
+            jitter_buffer->last_wake_time = xTaskGetTickCount();
+            jitter_buffer->dtx_silence_us = 0;
+            ulTaskNotifyTake(pdTRUE, 0);  /* 丢弃停止期间积压的时钟通知 */
+            if (jitter_buffer->event_group_ack != NULL) {
+                xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
+            }
+            while (1) {
+                EventBits_t bits = xEventGroupWaitBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START | JITTER_BUFFER_EVENT_EXIT | JITTER_BUFFER_EVENT_STOP, pdFALSE, pdFALSE, portMAX_DELAY);
+                if (bits & JITTER_BUFFER_EVENT_EXIT) {
+                    ESP_LOGI(TAG, "Jitter buffer task exit");
+                    jitter_buffer->running = false;
+                    break;
+                }
+                if (bits & JITTER_BUFFER_EVENT_STOP) {
+                    ESP_LOGI(TAG, "Jitter buffer task stop");
+                    /* START 不清除会让外层循环立即重新进入，STOP 不清除会让下次 start 立即退出 */
+                    xEventGroupClearBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_START | JITTER_BUFFER_EVENT_STOP);
+                    if (jitter_buffer->event_group_ack != NULL) {
+                        xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
+                    }
+                    break;
+                }
+                if (bits & JITTER_BUFFER_EVENT_START) {
+                    if (jitter_buffer->event_group_ack != NULL) {
+                        xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
+                    }
+                }
+                s_jitter_buffer_process(jitter_buffer);
+            }
+        }
+    }
+    /* ACK 之后 destroy 可能已释放实例，先取出 with_caps */
+    bool with_caps = jitter_buffer->task_with_caps;
+    if (jitter_buffer->event_group_ack != NULL) {
+        xEventGroupSetBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
+    }
+    jitter_buffer_priv_task_exit(with_caps);
+}
+
+/* 取出一帧但不拷贝：frame 指向环形缓冲内存，在 s_jitter_buffer_release() 之前保持有效
+ * mutex 模式下帧立即出队并计入 borrowed，写端不会覆盖；lock_free 模式下释放时才移动 read_pos
+ * 返回帧长度，0 表示本拍无数据，JITTER_READ_TIMEOUT 表示等锁超时，-1 表示错误 */
+static int s_jitter_buffer_acquire(jitter_buffer_t *jitter_buffer, size_t len, jitter_buffer_output_frame_t *frame)
+{
+    if (jitter_buffer->buffer == NULL) {
+        return -1;
+    }
+
+    JITTER_PROF_BEGIN(JITTER_PROFILE_READ_LOCK, t_lock);
+    bool locked = s_lock_timed(jitter_buffer, jitter_buffer->config.read_timeout_ms);
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_READ_LOCK, t_lock);
+    if (!locked) {
+        ESP_LOGW(TAG, "Jitter buffer read: mutex timeout");
+        return JITTER_READ_TIMEOUT;
+    }
+
+    if (jitter_buffer->config.lock_free) {
+        s_handle_reset_request(jitter_buffer);
+    }
+    s_handle_flush_request(jitter_buffer);
+    s_stage_merge(jitter_buffer);
+
+    JITTER_PROF_BEGIN(JITTER_PROFILE_FRAME_COUNT, t_count);
+    size_t frame_count = s_get_frame_count(jitter_buffer);
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_FRAME_COUNT, t_count);
+    jitter_buffer->trace_depth = frame_count > UINT16_MAX ? UINT16_MAX : (uint16_t)frame_count;
+    if (frame_count < jitter_buffer->depth_min) {
+        jitter_buffer->depth_min = (uint32_t)frame_count;
+    }
+    if (frame_count > jitter_buffer->depth_max) {
+        jitter_buffer->depth_max = (uint32_t)frame_count;
+    }
+    jitter_buffer->depth_sum += frame_count;
+    jitter_buffer->depth_samples++;
+    if (jitter_buffer->config.drift_compensation) {
+        s_drift_track(jitter_buffer);
+    }
+
+    // 状态机：在读路径也检查高水位，避免“刚切到 PLAYING 时 buffer 已满、下一拍写 overrun”
+    jitter_buffer_state_t state = atomic_load(&jitter_buffer->state);
+    bool draining = atomic_load(&jitter_buffer->draining);
+    if (state == JITTER_STATE_BUFFERING || state == JITTER_STATE_UNDERRUN) {
+        /* drain 时不等水位，有数据即播放 */
+        if (frame_count >= s_start_water(jitter_buffer, state) || (draining && frame_count > 0)) {
+            if (s_state_transit(jitter_buffer, state, JITTER_STATE_PLAYING)) {
+                atomic_store(&jitter_buffer->ramp_depth, (uint32_t)frame_count);
+                s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_PLAYING, 0);
+                s_defer(jitter_buffer, JITTER_DEFER_LOG_PLAYING, (uint32_t)frame_count, 0);
+            }
+        } else {
+            if (draining && frame_count == 0 && atomic_exchange(&jitter_buffer->draining, false)) {
+                s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_DRAINED, 0);
+            }
+            s_unlock(jitter_buffer);
+            return 0;
+        }
+    }
+
+    if (draining && frame_count == 0 && atomic_load(&jitter_buffer->state) == JITTER_STATE_PLAYING) {
+        /* 尾部已播完：回到蓄水状态等待下一段流 */
+        atomic_store(&jitter_buffer->fast_start, jitter_buffer->config.start_water > 0);
+        if (atomic_exchange(&jitter_buffer->draining, false) &&
+            s_state_transit(jitter_buffer, JITTER_STATE_PLAYING, JITTER_STATE_BUFFERING)) {
+            s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_DRAINED, 0);
+            s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_BUFFERING, 0);
+        }
+        s_unlock(jitter_buffer);
+        return 0;
+    }
+
+    if (atomic_load(&jitter_buffer->flush_hold) && atomic_load(&jitter_buffer->state) == JITTER_STATE_PLAYING) {
+        if (frame_count < s_flush_resume(jitter_buffer)) {
+            s_unlock(jitter_buffer);
+            return 0;  /* flush 后等待新数据，保持 PLAYING 与时钟相位 */
+        }
+        /* 按快速起播的方式恢复：低水位随深度等比放宽，深度逐步长回 high_water */
+        atomic_store(&jitter_buffer->flush_hold, false);
+        atomic_store(&jitter_buffer->ramp_depth, (uint32_t)frame_count);
+        atomic_store(&jitter_buffer->fast_start, frame_count + 1 < atomic_load(&jitter_buffer->high_water));
+    }
+
+    // 状态机：低于低水位时进入欠载状态；drain 时播放尾部，不做欠载判断
+    if (!draining && atomic_load(&jitter_buffer->state) == JITTER_STATE_PLAYING) {
+        if (atomic_load(&jitter_buffer->fast_start) && frame_count > atomic_load(&jitter_buffer->ramp_depth)) {
+            /* 快速起播：深度长到 high_water（差一帧以内，即漂移补偿的死区）即结束，之后按正常水位运行 */
+            atomic_store(&jitter_buffer->ramp_depth, (uint32_t)frame_count);
+            if (frame_count + 1 >= atomic_load(&jitter_buffer->high_water)) {
+                atomic_store(&jitter_buffer->fast_start, false);
+            }
+        }
+        if (frame_count < s_low_water(jitter_buffer)) {
+            /* 快速起播期间欠载则放弃，重新蓄水到完整的 high_water */
+            atomic_store(&jitter_buffer->fast_start, false);
+            if (s_state_transit(jitter_buffer, JITTER_STATE_PLAYING, JITTER_STATE_UNDERRUN)) {
+                jitter_buffer->underrun_count++;
+                s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_UNDERRUN, 0);
+                s_defer(jitter_buffer, JITTER_DEFER_LOG_UNDERRUN, (uint32_t)frame_count, jitter_buffer->underrun_count);
+            }
+            s_unlock(jitter_buffer);
+            return 0;  // 返回0表示暂时没有数据，但不是错误
+        }
+    }
+
+    if (jitter_buffer->slots != NULL) {
+        /* 包模式：每拍按序号取一个槽位，缺失时向播放循环报告 gap */
+        uint32_t index = jitter_buffer->next_index;
+        jitter_packet_slot_t *slot = &jitter_buffer->slots[index];
+        uint16_t seq = jitter_buffer->next_seq++;
+        jitter_buffer->next_index = s_slot_index(jitter_buffer, 1);
+        if (atomic_load(&jitter_buffer->sample_pending) && (int16_t)(seq - jitter_buffer->sample_seq) >= 0) {
+            if (seq == jitter_buffer->sample_seq && slot->valid && slot->seq == seq) {
+                s_record_residence(jitter_buffer, esp_timer_get_time() - jitter_buffer->sample_time_us);
+            }
+            atomic_store(&jitter_buffer->sample_pending, false);
+        }
+        if (!slot->valid || slot->seq != seq) {
+            slot->valid = false;
+            jitter_buffer->lost_count++;
+            s_unlock(jitter_buffer);
+            return JITTER_READ_GAP;
+        }
+        slot->valid = false;
+        jitter_buffer->seq_played = true;
+        jitter_buffer->total_read += slot->len;
+        frame->data = jitter_buffer->buffer + (size_t)index * jitter_buffer->config.frame_size;
+        frame->len = slot->len;
+        frame->data2 = NULL;
+        frame->len2 = 0;
+        if (s_adapt_should_drop(jitter_buffer, frame_count, frame)) {
+            s_unlock(jitter_buffer);
+            return s_jitter_buffer_acquire(jitter_buffer, len, frame);
+        }
+        atomic_store(&jitter_buffer->borrowed_slot, (int32_t)index);
+        s_unlock(jitter_buffer);
+        return (int)slot->len;
+    }
+
+    // 定位数据
+    size_t pos;
+    size_t frame_len;
+    size_t rec_len;
+    if (jitter_buffer->config.with_header) {
+        /* 带头格式：先 peek 2 字节大端长度，数据够再整帧读 */
+        size_t payload_len;
+        rec_len = s_peek_record(jitter_buffer, 0, atomic_load(&jitter_buffer->data_size), &payload_len);
+        if (rec_len > 0 && payload_len == SIZE_MAX) {
+            /* 跳过缓冲末尾的对齐填充 */
+            s_ring_skip(jitter_buffer, rec_len);
+            rec_len = s_peek_record(jitter_buffer, 0, atomic_load(&jitter_buffer->data_size), &payload_len);
+        }
+        if (rec_len == 0) {
+            s_unlock(jitter_buffer);
+            return 0;  /* 整帧未到齐，不消费 */
+        }
+        if (payload_len > jitter_buffer->config.frame_size || payload_len == 0) {
+            /* frame_size 为 with_header 时单帧 payload 上限 */
+            if (payload_len > 0) {
+                ESP_LOGW(TAG, "Jitter buffer read: header len=%zu > max_payload(%u), skip frame", payload_len, jitter_buffer->config.frame_size);
+            }
+            s_frame_removed(jitter_buffer, 0, rec_len, payload_len);
+            s_ring_skip(jitter_buffer, rec_len);
+            jitter_buffer->discard_count++;
+            s_unlock(jitter_buffer);
+            return 0;  /* 丢弃整帧，下次从下一帧头对齐 */
+        }
+        pos = s_ring_wrap(jitter_buffer, jitter_buffer->read_pos + rec_len - s_record_payload(jitter_buffer, payload_len));
+        frame_len = payload_len;
+        s_frame_removed(jitter_buffer, 0, rec_len, payload_len);
+    } else {
+        /* 无头：按固定帧长读 */
+        size_t data_size = atomic_load(&jitter_buffer->data_size);
+        frame_len = (len < data_size) ? len : data_size;
+        if (frame_len == 0) {
+            s_unlock(jitter_buffer);
+            return 0;
+        }
+        pos = jitter_buffer->read_pos;
+        rec_len = frame_len;
+    }
+
+    size_t first = jitter_buffer->buffer_size - pos;
+    if (first > frame_len) {
+        first = frame_len;
+    }
+    frame->data = jitter_buffer->buffer + pos;
+    frame->len = first;
+    frame->data2 = (frame_len > first) ? jitter_buffer->buffer : NULL;
+    frame->len2 = frame_len - first;
+
+    if (s_adapt_should_drop(jitter_buffer, frame_count, frame) || s_compress_should_drop(jitter_buffer, frame_count)) {
+        /* 丢弃本帧，本拍改为输出下一帧；shrink_wait/compress_ticks 已清零，不会连续丢帧 */
+        s_ring_skip(jitter_buffer, rec_len);
+        s_unlock(jitter_buffer);
+        return s_jitter_buffer_acquire(jitter_buffer, len, frame);
+    }
+
+    if (jitter_buffer->config.lock_free) {
+        jitter_buffer->pending_release = rec_len;
+    } else {
+        s_ring_skip(jitter_buffer, rec_len);
+        atomic_store(&jitter_buffer->borrowed, rec_len);
+    }
+    s_unlock(jitter_buffer);
+    return (int)frame_len;
+}
+
+/* 释放 s_jitter_buffer_acquire() 取出的帧，其内存可被写端复用 */
+static void s_jitter_buffer_release(jitter_buffer_t *jitter_buffer)
+{
+    if (jitter_buffer->slots != NULL) {
+        atomic_store(&jitter_buffer->borrowed_slot, -1);
+    } else if (jitter_buffer->config.lock_free) {
+        s_ring_skip(jitter_buffer, jitter_buffer->pending_release);
+        jitter_buffer->pending_release = 0;
+    } else {
+        atomic_store(&jitter_buffer->borrowed, 0);
+    }
+}
+
+static int s_jitter_buffer_read(jitter_buffer_t *jitter_buffer, uint8_t *data, size_t len)
+{
+    jitter_buffer_output_frame_t frame;
+    int read_len = s_jitter_buffer_acquire(jitter_buffer, len, &frame);
+    if (read_len > 0) {
+        JITTER_PROF_BEGIN(JITTER_PROFILE_READ_COPY, t_copy);
+        memcpy(data, frame.data, frame.len);
+        if (frame.len2 > 0) {
+            memcpy(data + frame.len, frame.data2, frame.len2);
+        }
+        JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_READ_COPY, t_copy);
+        s_jitter_buffer_release(jitter_buffer);
+    }
+    return read_len;
+}
+
+/* 按 buffer_caps 分配缓冲，0 时优先 PSRAM，不足再用内部 RAM */
+static void *s_buffer_calloc(const jitter_buffer_config_t *config, size_t size)
+{
+    if (config->buffer_caps == 0) {
+        return heap_caps_calloc_prefer(1, size, 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_INTERNAL);
+    }
+    return heap_caps_calloc(1, size, config->buffer_caps);
+}
+
+/* 按配置计算环形缓冲大小，*mask 为 pow2_ring 时的下标掩码（否则为 0）；create 与 reconfigure 共用
+ * jb 只用于按 jb->config 的帧头格式计算记录长度，返回 false 表示该配置无法满足 */
+static bool s_ring_layout(jitter_buffer_t *jb, const jitter_buffer_config_t *config, size_t *size, size_t *mask)
+{
+    size_t buffer_size = config->buffer_size;
+    *mask = 0;
+    /* 包模式：每个槽位固定 frame_size 字节，按相对 next_seq 的偏移从 next_index 起存放（见 s_slot_index()）
+     * with_header 时每帧长度不固定；frame_size 为 payload 上限，按最坏（每帧均为上限）保证至少能容纳 high_water 帧 */
+    if (config->packet_slots > 0) {
+        buffer_size = (size_t)config->packet_slots * config->frame_size;
+    } else if (config->with_header) {
+        uint32_t max_water = config->adaptive_delay ? config->max_high_water : config->high_water;
+        size_t min_size = (size_t)max_water * (s_header_len(jb, config->frame_size) + s_record_payload(jb, config->frame_size));
+        if (buffer_size < min_size) {
+            ESP_LOGW(TAG, "Jitter buffer: with_header needs buffer_size >= %zu (high_water*(header+max_payload)), adjust %zu -> %zu",
+                     min_size, buffer_size, min_size);
+            buffer_size = min_size;
+        }
+    } else if (config->contiguous_frames && buffer_size % config->frame_size != 0) {
+        /* 无头时缓冲为帧长整数倍，整帧读写永不跨越缓冲末尾 */
+        size_t aligned = (buffer_size / config->frame_size + 1) * config->frame_size;
+        ESP_LOGW(TAG, "Jitter buffer: contiguous_frames needs buffer_size multiple of frame_size, adjust %zu -> %zu",
+                 buffer_size, aligned);
+        buffer_size = aligned;
+    }
+    if (config->packet_slots == 0 && config->align_frames && buffer_size % JITTER_ALIGN != 0) {
+        buffer_size = (buffer_size + JITTER_ALIGN - 1) & ~(size_t)(JITTER_ALIGN - 1);
+    }
+    if (config->packet_slots == 0 && config->pow2_ring) {
+        size_t pow2 = JITTER_ALIGN;
+        while (pow2 < buffer_size) {
+            pow2 <<= 1;
+        }
+        if (config->contiguous_frames && !config->with_header && pow2 % config->frame_size != 0) {
+            ESP_LOGE(TAG, "Jitter buffer: pow2_ring with contiguous_frames needs a power-of-two frame_size");
+            return false;
+        }
+        buffer_size = pow2;
+        *mask = pow2 - 1;
+    }
+    *size = buffer_size;
+    return true;
+}
+
+jitter_buffer_handle_t jitter_buffer_create(const jitter_buffer_config_t *config)
+{
+    if (config->frame_interval <= 0) {
+        ESP_LOGE(TAG, "Jitter buffer create: frame_interval <= 0");
+        return NULL;
+    }
+    if (config->audio_format_id == AUDIO_FORMAT_ID_OPUS && config->output_silence_on_empty) {
+        if (config->frame_interval != 20 && config->frame_interval != 40 && config->frame_interval != 60 && config->frame_interval != 120) {
+            ESP_LOGE(TAG, "Jitter buffer create: frame_interval is not supported for OPUS format");
+            return NULL;
+        }
+    }
+    /* 拉模式与混音调度器下帧由调用方/调度器取走，不经过输出回调 */
+    bool pull = config->clock_source == JITTER_CLOCK_PULL ||
+                (config->scheduler != NULL && jitter_buffer_scheduler_mixing(config->scheduler));
+    if (config->on_output_data == NULL && config->on_output_frame == NULL && !pull) {
+        ESP_LOGE(TAG, "Jitter buffer create: on_output_data or on_output_frame is required");
+        return NULL;
+    }
+    if (config->packet_slots > 0 && (config->lock_free || config->packet_slots > JITTER_PACKET_SLOTS_MAX || config->frame_size > UINT16_MAX)) {
+        ESP_LOGE(TAG, "Jitter buffer create: packet_slots must be <= %u, frame_size <= %u, and lock_free is not supported",
+                 JITTER_PACKET_SLOTS_MAX, UINT16_MAX);
+        return NULL;
+    }
+    if (config->adaptive_delay &&
+        (config->min_high_water == 0 || config->max_high_water < config->min_high_water || config->high_water == 0 ||
+         (config->packet_slots > 0 && config->max_high_water > config->packet_slots))) {
+        ESP_LOGE(TAG, "Jitter buffer create: adaptive_delay needs 0 < min_high_water <= max_high_water (<= packet_slots)");
+        return NULL;
+    }
+    /* adaptive_delay 可把 high_water 降到 min_high_water，start_water 须低于整个可调范围 */
+    if (config->start_water > 0 &&
+        config->start_water >= (config->adaptive_delay ? config->min_high_water : config->high_water)) {
+        ESP_LOGE(TAG, "Jitter buffer create: start_water must be < high_water (min_high_water with adaptive_delay), 0 to disable");
+        return NULL;
+    }
+    if (config->clock_source != JITTER_CLOCK_TASK_TICK && config->scheduler != NULL) {
+        ESP_LOGE(TAG, "Jitter buffer create: clock_source is driven by the scheduler tick when scheduler is set");
+        return NULL;
+    }
+    if (config->drift_compensation &&
+        (config->audio_format_id != AUDIO_FORMAT_ID_PCM || config->with_header || config->packet_slots > 0 ||
+         config->contiguous_frames || config->frame_size % ((config->pcm_channels > 0 ? config->pcm_channels : 1) * sizeof(int16_t)) != 0)) {
+        ESP_LOGE(TAG, "Jitter buffer create: drift_compensation needs PCM without header or contiguous_frames in FIFO mode, "
+                 "and frame_size a multiple of the sample frame");
+        return NULL;
+    }
+    if (config->overrun_policy == JITTER_OVERRUN_COMPRESS && (config->compress_interval < 2 || config->lock_free)) {
+        ESP_LOGE(TAG, "Jitter buffer create: JITTER_OVERRUN_COMPRESS needs compress_interval >= 2 and no lock_free");
+        return NULL;
+    }
+    if (config->align_frames && !config->with_header &&
+        (config->frame_size % JITTER_ALIGN != 0 ||
+         (config->drift_compensation && (config->pcm_channels > 0 ? config->pcm_channels : 1) * sizeof(int16_t) % JITTER_ALIGN != 0))) {
+        ESP_LOGE(TAG, "Jitter buffer create: align_frames without header needs frame_size and the drift step multiple of %d",
+                 JITTER_ALIGN);
+        return NULL;
+    }
+    if (config->opus_duration &&
+        (!config->with_header || config->audio_format_id != AUDIO_FORMAT_ID_OPUS || config->packet_slots > 0)) {
+        ESP_LOGE(TAG, "Jitter buffer create: opus_duration needs with_header and AUDIO_FORMAT_ID_OPUS in FIFO mode");
+        return NULL;
+    }
+    if (config->dtx_suspend_ms > 0 &&
+        (config->clock_source != JITTER_CLOCK_TASK_TICK || config->scheduler != NULL || config->packet_slots > 0)) {
+        ESP_LOGE(TAG, "Jitter buffer create: dtx_suspend_ms needs the own JITTER_CLOCK_TASK_TICK task in FIFO mode");
+        return NULL;
+    }
+    if (config->with_header && config->frame_size >= s_header_payload_max(config)) {
+        ESP_LOGE(TAG, "Jitter buffer create: with_header max payload must be < %u", (unsigned)s_header_payload_max(config));
+        return NULL;
+    }
+
+    /* calloc：出错时 __err 按非 NULL 逐项释放 */
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)calloc(1, sizeof(jitter_buffer_t));
+    if (jitter_buffer == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer create: calloc failed");
+        return NULL;
+    }
+    jitter_buffer->config = *config;
+    portMUX_INITIALIZE(&jitter_buffer->defer_lock);
+    portMUX_INITIALIZE(&jitter_buffer->trace_lock);
+    jitter_buffer->buffer = NULL;
+    if (!s_ring_layout(jitter_buffer, config, &jitter_buffer->buffer_size, &jitter_buffer->buffer_mask)) {
+        free(jitter_buffer);
+        return NULL;
+    }
+    jitter_buffer->write_pos = 0;
+    jitter_buffer->read_pos = 0;
+    jitter_buffer->data_size = 0;
+    jitter_buffer->frame_count = 0;
+    jitter_buffer->buffered_us = 0;
+    jitter_buffer->total_read = 0;
+    jitter_buffer->total_written = 0;
+    jitter_buffer->reset_mark = 0;
+    jitter_buffer->reset_gen = 0;
+    jitter_buffer->reset_gen_seen = 0;
+    jitter_buffer->reserve_len = 0;
+    jitter_buffer->reserve_pad = 0;
+    jitter_buffer->reserved = false;
+    jitter_buffer->borrowed = 0;
+    jitter_buffer->pending_release = 0;
+    jitter_buffer->borrowed_slot = -1;
+    jitter_buffer->depth_min = UINT32_MAX;
+    s_water_init(jitter_buffer);
+    jitter_buffer->underrun_count = 0;
+    jitter_buffer->overrun_count = 0;
+    jitter_buffer->state = JITTER_STATE_IDLE;
+    if (config->user_buffer != NULL) {
+        /* 调用方提供的缓冲不能扩容，按上面调整后的大小检查 */
+        if (config->buffer_size < jitter_buffer->buffer_size) {
+            ESP_LOGE(TAG, "Jitter buffer create: user_buffer too small, buffer_size=%zu, need %zu",
+                     config->buffer_size, jitter_buffer->buffer_size);
+            goto __err;
+        }
+        if (config->align_frames && ((uintptr_t)config->user_buffer % JITTER_ALIGN) != 0) {
+            ESP_LOGE(TAG, "Jitter buffer create: align_frames needs a %d-byte aligned user_buffer", JITTER_ALIGN);
+            goto __err;
+        }
+        jitter_buffer->buffer = config->user_buffer;
+    } else {
+        jitter_buffer->buffer = s_buffer_calloc(config, jitter_buffer->buffer_size);
+        if (jitter_buffer->buffer == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer create: buffer alloc failed, buffer_size=%zu, caps=0x%lx",
+                     jitter_buffer->buffer_size, (unsigned long)config->buffer_caps);
+            goto __err;
+        }
+    }
+    if (config->packet_slots > 0) {
+        jitter_buffer->slots = (jitter_packet_slot_t *)calloc(config->packet_slots, sizeof(jitter_packet_slot_t));
+        if (jitter_buffer->slots == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer create: calloc slots failed, packet_slots=%u", (unsigned)config->packet_slots);
+            goto __err;
+        }
+    }
+    /* 零拷贝输出不需要 frame_buffer，仅 PCM 静音帧与隐藏帧需要一块输出缓冲 */
+    bool conceal = config->on_conceal != NULL || config->conceal_mode == JITTER_CONCEAL_REPEAT_FADE;
+    bool need_frame_buffer = (config->on_output_frame == NULL && !pull) ||
+                             (config->drift_compensation && !pull) ||
+                             (config->output_silence_on_empty && config->audio_format_id == AUDIO_FORMAT_ID_PCM) ||
+                             (conceal && (config->on_conceal != NULL || config->audio_format_id == AUDIO_FORMAT_ID_PCM));
+    if (need_frame_buffer) {
+        jitter_buffer->frame_buffer_size = config->frame_size;
+        if (config->drift_compensation) {
+            jitter_buffer->frame_buffer_size += (config->pcm_channels > 0 ? config->pcm_channels : 1) * sizeof(int16_t);
+        }
+        jitter_buffer->frame_buffer = s_buffer_calloc(config, jitter_buffer->frame_buffer_size);
+        if (jitter_buffer->frame_buffer == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer create: frame_buffer alloc failed");
+            goto __err;
+        }
+    }
+    if (conceal) {
+        jitter_buffer->prev_frame = s_buffer_calloc(config, config->frame_size);
+        if (jitter_buffer->prev_frame == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer create: prev_frame alloc failed");
+            goto __err;
+        }
+    }
+    if (config->trace_entries > 0) {
+        jitter_buffer->trace = s_buffer_calloc(config, (size_t)config->trace_entries * sizeof(jitter_buffer_trace_entry_t));
+        if (jitter_buffer->trace == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer create: trace alloc failed, trace_entries=%u", (unsigned)config->trace_entries);
+            goto __err;
+        }
+    }
+    if (!config->lock_free && config->packet_slots == 0) {
+        /* write_nb 暂存槽，与环形缓冲同样按 buffer_caps 放置 */
+        jitter_buffer->stage = s_buffer_calloc(config, config->frame_size);
+        if (jitter_buffer->stage == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer create: stage alloc failed");
+            goto __err;
+        }
+    }
+    jitter_buffer->mutex = xSemaphoreCreateMutex();
+    if (jitter_buffer->mutex == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer create: xSemaphoreCreateMutex failed");
+        goto __err;
+    }
+    if (config->scheduler != NULL) {
+        /* 由共享调度器驱动输出，不创建独立任务 */
+        if (jitter_buffer_scheduler_add(config->scheduler, jitter_buffer, config) != ESP_OK) {
+            goto __err;
+        }
+        return (jitter_buffer_handle_t)jitter_buffer;
+    }
+    if (config->clock_source == JITTER_CLOCK_PULL) {
+        /* 由调用方 jitter_buffer_read() 驱动输出，不创建任务 */
+        return (jitter_buffer_handle_t)jitter_buffer;
+    }
+    jitter_buffer->event_group = xEventGroupCreate();
+    if (jitter_buffer->event_group == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer create: xEventGroupCreate failed");
+        goto __err;
+    }
+    jitter_buffer->event_group_ack = xEventGroupCreate();
+    if (jitter_buffer->event_group_ack == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer create: xEventGroupCreate(event_group_ack) failed");
+        goto __err;
+    }
+    if (config->clock_source == JITTER_CLOCK_ESP_TIMER) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = s_clock_timer_cb,
+            .arg = jitter_buffer,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "jitter_clock",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&timer_args, &jitter_buffer->clock_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Jitter buffer create: esp_timer_create failed");
+            goto __err;
+        }
     }
+    jitter_buffer->task_handle = NULL;
+    jitter_buffer->running = true;
 
-    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)malloc(sizeof(jitter_buffer_t));
-    if (jitter_buffer == NULL) {
-        ESP_LOGE(TAG, "Jitter buffer create: malloc failed");
-        return NULL;
+    /* task_stack 为 0 时（未使用 DEFAULT_JITTER_BUFFER_CONFIG 的旧配置）任务参数全部取默认值 */
+    if (config->task_stack == 0) {
+        jitter_buffer_priv_task_create(jitter_buffer_task, "jitter_buffer_task", jitter_buffer,
+                                       JITTER_TASK_STACK_DEFAULT, JITTER_TASK_PRIO_DEFAULT, JITTER_TASK_CORE_DEFAULT, 0,
+                                       &jitter_buffer->task_handle, &jitter_buffer->task_with_caps);
+    } else {
+        jitter_buffer_priv_task_create(jitter_buffer_task, "jitter_buffer_task", jitter_buffer,
+                                       config->task_stack, config->task_prio, config->task_core, config->task_stack_caps,
+                                       &jitter_buffer->task_handle, &jitter_buffer->task_with_caps);
     }
-    jitter_buffer->config = *config;
-    jitter_buffer->buffer = NULL;
-    jitter_buffer->buffer_size = config->buffer_size;
-    /* with_header 时每帧长度不固定；frame_size 为 payload 上限，按最坏（每帧均为上限）保证至少能容纳 high_water 帧 */
-    if (config->with_header) {
-        size_t min_size = (size_t)config->high_water * (JITTER_HEADER_LEN + config->frame_size);
-        if (jitter_buffer->buffer_size < min_size) {
-            ESP_LOGW(TAG, "Jitter buffer: with_header needs buffer_size >= %zu (high_water*(2+max_payload)), adjust %zu -> %zu",
-                     min_size, jitter_buffer->buffer_size, min_size);
-            jitter_buffer->buffer_size = min_size;
+
+    if (jitter_buffer->task_handle == NULL) {
+        ESP_LOGE(TAG, "Create jitter buffer task failed");
+        goto __err;
+    }
+
+    return (jitter_buffer_handle_t)jitter_buffer;
+
+__err:
+    if (jitter_buffer->clock_timer != NULL) {
+        esp_timer_delete(jitter_buffer->clock_timer);
+    }
+    if (jitter_buffer->event_group_ack != NULL) {
+        vEventGroupDelete(jitter_buffer->event_group_ack);
+    }
+    if (jitter_buffer->event_group != NULL) {
+        vEventGroupDelete(jitter_buffer->event_group);
+    }
+    if (jitter_buffer->mutex != NULL) {
+        vSemaphoreDelete(jitter_buffer->mutex);
+    }
+    if (config->user_buffer == NULL) {
+        free(jitter_buffer->buffer);
+    }
+    free(jitter_buffer->frame_buffer);
+    free(jitter_buffer->slots);
+    free(jitter_buffer->prev_frame);
+    free(jitter_buffer->trace);
+    free(jitter_buffer->stage);
+    free(jitter_buffer);
+    return NULL;
+}
+
+esp_err_t jitter_buffer_destroy(jitter_buffer_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+
+    if (jitter_buffer->config.scheduler != NULL) {
+        /* 移除时会等待调度器当前一拍结束，之后不会再访问本实例 */
+        jitter_buffer_scheduler_remove(jitter_buffer->config.scheduler, jitter_buffer);
+    } else if (jitter_buffer->config.clock_source != JITTER_CLOCK_PULL) {
+        /* 先清除 start/stop 留下的 ACK，否则不等任务退出就释放内存 */
+        if (jitter_buffer->event_group_ack != NULL) {
+            xEventGroupClearBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK);
+        }
+        if (jitter_buffer->clock_timer != NULL) {
+            esp_timer_stop(jitter_buffer->clock_timer);
+            esp_timer_delete(jitter_buffer->clock_timer);
+            jitter_buffer->clock_timer = NULL;
+        }
+        xEventGroupSetBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_EXIT);
+        s_clock_wake(jitter_buffer);
+        if (jitter_buffer->event_group_ack != NULL) {
+            xEventGroupWaitBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK,
+                               pdFALSE, pdFALSE, pdMS_TO_TICKS(500));
+        }
+        jitter_buffer_priv_task_delete(jitter_buffer->task_handle, jitter_buffer->task_with_caps);
+    }
+
+    if (jitter_buffer->buffer != NULL) {
+        if (jitter_buffer->config.user_buffer == NULL) {
+            free(jitter_buffer->buffer);
+        }
+        jitter_buffer->buffer = NULL;
+    }
+    if (jitter_buffer->frame_buffer != NULL) {
+        free(jitter_buffer->frame_buffer);
+        jitter_buffer->frame_buffer = NULL;
+    }
+    if (jitter_buffer->slots != NULL) {
+        free(jitter_buffer->slots);
+        jitter_buffer->slots = NULL;
+    }
+    if (jitter_buffer->prev_frame != NULL) {
+        free(jitter_buffer->prev_frame);
+        jitter_buffer->prev_frame = NULL;
+    }
+    if (jitter_buffer->trace != NULL) {
+        free(jitter_buffer->trace);
+        jitter_buffer->trace = NULL;
+    }
+    if (jitter_buffer->stage != NULL) {
+        free(jitter_buffer->stage);
+        jitter_buffer->stage = NULL;
+    }
+    if (jitter_buffer->mutex != NULL) {
+        vSemaphoreDelete(jitter_buffer->mutex);
+        jitter_buffer->mutex = NULL;
+    }
+    if (jitter_buffer->event_group != NULL) {
+        vEventGroupDelete(jitter_buffer->event_group);
+        jitter_buffer->event_group = NULL;
+    }
+    if (jitter_buffer->event_group_ack != NULL) {
+        vEventGroupDelete(jitter_buffer->event_group_ack);
+        jitter_buffer->event_group_ack = NULL;
+    }
+    jitter_buffer->task_handle = NULL;
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_reset(jitter_buffer_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    if (jitter_buffer->config.lock_free) {
+        /* 生产者不能移动 read_pos，记录丢弃位置，由消费者在下一次读取时丢弃 */
+        atomic_store(&jitter_buffer->reset_mark, jitter_buffer->total_written);
+        atomic_fetch_add(&jitter_buffer->reset_gen, 1);
+        jitter_buffer->last_arrival_us = 0;
+        atomic_store(&jitter_buffer->fast_start, jitter_buffer->config.start_water > 0);
+        atomic_store(&jitter_buffer->flush_hold, false);
+        atomic_store(&jitter_buffer->draining, false);
+        atomic_store(&jitter_buffer->state, JITTER_STATE_BUFFERING);
+        s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_BUFFERING, 0);
+        s_defer_flush(jitter_buffer);
+        return ESP_OK;
+    }
+    if (xSemaphoreTake(jitter_buffer->mutex, pdMS_TO_TICKS(500)) != pdTRUE) {
+        ESP_LOGW(TAG, "Jitter buffer reset: mutex timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+    s_clear_locked(jitter_buffer);
+    jitter_buffer->fast_start = jitter_buffer->config.start_water > 0;
+    jitter_buffer->flush_hold = false;
+    atomic_fetch_add(&jitter_buffer->reset_gen, 1);  /* mutex 模式下只用于通知消费者清零 opus 节拍额度 */
+    jitter_buffer->state = JITTER_STATE_BUFFERING;
+    s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_BUFFERING, 0);
+    xSemaphoreGive(jitter_buffer->mutex);
+    s_defer_flush(jitter_buffer);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_flush(jitter_buffer_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    if (jitter_buffer->config.lock_free) {
+        /* 与 reset 相同由消费者丢弃数据，但不改变状态；FLUSHED 由消费者处理后发出 */
+        atomic_store(&jitter_buffer->reset_mark, jitter_buffer->total_written);
+        atomic_fetch_add(&jitter_buffer->reset_gen, 1);
+        jitter_buffer->last_arrival_us = 0;
+        atomic_store(&jitter_buffer->draining, false);
+        atomic_store(&jitter_buffer->flush_hold, atomic_load(&jitter_buffer->state) == JITTER_STATE_PLAYING);
+        atomic_fetch_add(&jitter_buffer->flush_gen, 1);
+        return ESP_OK;
+    }
+    if (xSemaphoreTake(jitter_buffer->mutex, pdMS_TO_TICKS(500)) != pdTRUE) {
+        ESP_LOGW(TAG, "Jitter buffer flush: mutex timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+    s_clear_locked(jitter_buffer);
+    jitter_buffer->flush_hold = jitter_buffer->state == JITTER_STATE_PLAYING;
+    jitter_buffer->flush_gen++;
+    s_defer(jitter_buffer, JITTER_DEFER_EVENT, JITTER_EVENT_FLUSHED, 0);
+    xSemaphoreGive(jitter_buffer->mutex);
+    s_defer_flush(jitter_buffer);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_drain(jitter_buffer_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    /* 由消费者在读空时清除并发出 DRAINED，这里只置位 */
+    atomic_store(&jitter_buffer->flush_hold, false);
+    atomic_store(&jitter_buffer->draining, true);
+    s_dtx_resume(jitter_buffer);  /* 挂起时缓冲里可能还有低于水位的尾部 */
+    return ESP_OK;
+}
+
+static void s_reconfig_free(jitter_reconfig_t *rc)
+{
+    free(rc->buffer);
+    free(rc->frame_buffer);
+    free(rc->prev_frame);
+    free(rc->stage);
+}
+
+esp_err_t jitter_buffer_reconfigure(jitter_buffer_handle_t handle, const jitter_buffer_reconfig_t *reconfig)
+{
+    if (handle == NULL || reconfig == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    if (jb->config.lock_free || jb->slots != NULL || jb->pooled) {
+        ESP_LOGW(TAG, "Jitter buffer reconfigure: not supported in lock_free or packet mode, or on a pool instance");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /* 0 表示保持当前值，按合并后的配置做与 create 相同的检查 */
+    jitter_reconfig_t rc = { .want = *reconfig };
+    jitter_buffer_reconfig_t *want = &rc.want;
+    want->buffer_size = want->buffer_size ? want->buffer_size : jb->config.buffer_size;
+    want->frame_size = want->frame_size ? want->frame_size : jb->config.frame_size;
+    want->high_water = want->high_water ? want->high_water : jb->config.high_water;
+    want->low_water = want->low_water ? want->low_water : jb->config.low_water;
+    want->min_high_water = want->min_high_water ? want->min_high_water : jb->config.min_high_water;
+    want->max_high_water = want->max_high_water ? want->max_high_water : jb->config.max_high_water;
+    jitter_buffer_config_t next = jb->config;
+    next.buffer_size = want->buffer_size;
+    next.frame_size = want->frame_size;
+    next.high_water = want->high_water;
+    next.low_water = want->low_water;
+    next.min_high_water = want->min_high_water;
+    next.max_high_water = want->max_high_water;
+    if (next.start_water > 0 && next.start_water >= (next.adaptive_delay ? next.min_high_water : next.high_water)) {
+        ESP_LOGE(TAG, "Jitter buffer reconfigure: start_water must be < high_water (min_high_water with adaptive_delay)");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (next.adaptive_delay && (next.min_high_water == 0 || next.max_high_water < next.min_high_water)) {
+        ESP_LOGE(TAG, "Jitter buffer reconfigure: adaptive_delay needs 0 < min_high_water <= max_high_water");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (next.align_frames && !next.with_header && next.frame_size % JITTER_ALIGN != 0) {
+        ESP_LOGE(TAG, "Jitter buffer reconfigure: align_frames without header needs frame_size multiple of %d", JITTER_ALIGN);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (next.with_header && next.frame_size >= s_header_payload_max(&next)) {
+        ESP_LOGE(TAG, "Jitter buffer reconfigure: with_header max payload must be < %u", (unsigned)s_header_payload_max(&next));
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool frame_changed = next.frame_size != jb->config.frame_size;
+    if (frame_changed && next.scheduler != NULL && jitter_buffer_scheduler_mixing(next.scheduler)) {
+        ESP_LOGW(TAG, "Jitter buffer reconfigure: frame_size is fixed by the scheduler mixer");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!s_ring_layout(jb, &next, &rc.buffer_size, &rc.buffer_mask)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* frame_size 改变时重建环形缓冲：无头 contiguous_frames 的整帧对齐和 with_header 的帧长上限都按新帧长 */
+    bool ring_changed = rc.buffer_size != jb->buffer_size || frame_changed;
+    if (ring_changed && next.user_buffer != NULL) {
+        ESP_LOGW(TAG, "Jitter buffer reconfigure: user_buffer cannot be resized, only the water marks can change");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    bool alloc_failed = false;
+    if (ring_changed) {
+        rc.buffer = s_buffer_calloc(&next, rc.buffer_size);
+        alloc_failed |= rc.buffer == NULL;
+    }
+    if (frame_changed && jb->frame_buffer != NULL) {
+        rc.frame_buffer_size = next.frame_size + (jb->frame_buffer_size - jb->config.frame_size);
+        rc.frame_buffer = s_buffer_calloc(&next, rc.frame_buffer_size);
+        alloc_failed |= rc.frame_buffer == NULL;
+    }
+    if (frame_changed && jb->prev_frame != NULL) {
+        rc.prev_frame = s_buffer_calloc(&next, next.frame_size);
+        alloc_failed |= rc.prev_frame == NULL;
+    }
+    if (frame_changed && jb->stage != NULL) {
+        rc.stage = s_buffer_calloc(&next, next.frame_size);
+        alloc_failed |= rc.stage == NULL;
+    }
+    if (alloc_failed) {
+        ESP_LOGE(TAG, "Jitter buffer reconfigure: alloc failed, buffer_size=%zu", rc.buffer_size);
+        s_reconfig_free(&rc);
+        return ESP_ERR_NO_MEM;
+    }
+
+    jitter_reconfig_t *expected = NULL;
+    if (!atomic_compare_exchange_strong(&jb->reconfig, &expected, &rc)) {
+        ESP_LOGW(TAG, "Jitter buffer reconfigure: another reconfigure is in progress");
+        s_reconfig_free(&rc);
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* 播放中由消费者在下一拍开始时换入，时钟不停、相位不变；停止时没有消费者，由调用方直接换入 */
+    s_dtx_resume(jb);
+    TickType_t wait = pdMS_TO_TICKS(JITTER_RECONFIG_WAIT_FRAMES * jb->config.frame_interval + JITTER_LOCK_TIMEOUT_MS);
+    TickType_t start = xTaskGetTickCount();
+    while (!atomic_load(&rc.done) && !atomic_load(&rc.aborted)) {
+        if (!atomic_load(&jb->active)) {
+            s_handle_reconfig_request(jb);
+            if (atomic_load(&rc.done)) {
+                break;
+            }
+        }
+        if (xTaskGetTickCount() - start >= wait) {
+            /* 撤回失败说明消费者已取得请求，等它完成 */
+            expected = &rc;
+            if (atomic_compare_exchange_strong(&jb->reconfig, &expected, NULL)) {
+                break;
+            }
+        }
+        vTaskDelay(1);
+    }
+    /* 成功时 rc 中为换出的旧缓冲，超时时为未使用的新缓冲 */
+    s_reconfig_free(&rc);
+    if (atomic_load(&rc.aborted)) {
+        ESP_LOGW(TAG, "Jitter buffer reconfigure: instance recycled before the swap");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!atomic_load(&rc.done)) {
+        ESP_LOGW(TAG, "Jitter buffer reconfigure: timeout waiting for the playout tick");
+        return ESP_ERR_TIMEOUT;
+    }
+    s_defer_flush(jb);
+    ESP_LOGI(TAG, "Jitter buffer reconfigure: buffer_size=%zu, frame_size=%u, high/low_water=%u/%u, kept %u frames, dropped %u",
+             jb->buffer_size, (unsigned)want->frame_size, (unsigned)want->high_water, (unsigned)want->low_water,
+             (unsigned)rc.kept, (unsigned)rc.dropped);
+    return ESP_OK;
+}
+
+/* 写入一帧（调用方需已持有 mutex）；room_made 为 true 时调用方已为本帧腾出空间 */
+static esp_err_t s_write_frame(jitter_buffer_t *jitter_buffer, const uint8_t *data, size_t len, bool room_made)
+{
+    /* 被拒绝的写入（长度、对齐、DROP_NEWEST）不记入 trace，回放时不会被当作到达的流量 */
+    size_t depth = jitter_buffer->trace != NULL ? s_get_frame_count(jitter_buffer) : 0;
+    size_t write_len = len;
+    size_t hdr_len = 0;
+    if (jitter_buffer->config.with_header) {
+        if (len >= s_header_payload_max(&jitter_buffer->config)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        hdr_len = s_header_len(jitter_buffer, len);
+        write_len = hdr_len + s_record_payload(jitter_buffer, len);  /* 长度头 + payload */
+    } else if (jitter_buffer->config.align_frames && len % JITTER_ALIGN != 0) {
+        return ESP_ERR_INVALID_SIZE;  /* 无头字节流只有写入长度对齐时读位置才保持对齐 */
+    }
+
+    /* contiguous_frames 时保证 payload 不跨越缓冲末尾，零拷贝输出总是单段 */
+    size_t pad = 0;
+    if (jitter_buffer->config.with_header && jitter_buffer->config.contiguous_frames) {
+        pad = s_wrap_pad(jitter_buffer, hdr_len, len);
+    }
+
+    if (!room_made) {
+        esp_err_t ret = s_make_room(jitter_buffer, pad + write_len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (jitter_buffer->config.with_header) {
+        s_ring_copy_in(jitter_buffer, s_frame_payload_pos(jitter_buffer, pad, hdr_len), data, len);
+        s_publish_frame(jitter_buffer, pad, hdr_len, len);
+    } else {
+        s_ring_write(jitter_buffer, data, len);
+    }
+    s_sample_arrival(jitter_buffer);
+    s_trace_write(jitter_buffer, len, depth);
+    return ESP_OK;
+}
+
+/* 把 write_nb 暂存的帧并入环形缓冲（调用方需已持有 mutex）；有未提交的预留时留到下次 */
+static void s_stage_merge(jitter_buffer_t *jb)
+{
+    if (jb->stage == NULL || jb->reserved || atomic_load(&jb->stage_state) != JITTER_STAGE_FULL) {
+        return;
+    }
+    if (s_write_frame(jb, jb->stage, jb->stage_len, false) == ESP_OK) {
+        s_adapt_on_arrival(jb, s_write_duration_us(jb, jb->stage, jb->stage_len));
+        s_check_start_playing(jb);
+    }
+    atomic_store(&jb->stage_state, JITTER_STAGE_EMPTY);
+}
+
+/* 写入前的公共检查并加锁，成功返回 ESP_OK 时调用方持有 mutex，且已并入暂存帧 */
+static esp_err_t s_write_begin(jitter_buffer_t *jitter_buffer, bool nb)
+{
+    if (jitter_buffer->buffer == NULL || jitter_buffer->mutex == NULL) {
+        ESP_LOGW(TAG, "Jitter buffer write: buffer or mutex is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (jitter_buffer->slots != NULL) {
+        ESP_LOGW(TAG, "Jitter buffer write: packet mode, use jitter_buffer_write_packet");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE_LOCK, t_lock);
+    if (nb) {
+        /* write_nb：只尝试一次，不等待也不计超时，由调用方暂存 */
+        if (!s_lock(jitter_buffer, 0)) {
+            JITTER_PROF_DROP(JITTER_PROFILE_WRITE_LOCK);
+            return ESP_ERR_TIMEOUT;
         }
+    } else if (!s_lock_timed(jitter_buffer, jitter_buffer->config.write_timeout_ms)) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE_LOCK);
+        ESP_LOGW(TAG, "Jitter buffer write: mutex timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE_LOCK, t_lock);
+    if (jitter_buffer->reserved) {
+        s_unlock(jitter_buffer);
+        ESP_LOGW(TAG, "Jitter buffer write: pending reservation, commit it first");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stage_merge(jitter_buffer);
+    return ESP_OK;
+}
+
+/* 单帧写入：加锁后写入并检查起播；nb 为 true 时不等待 mutex */
+static esp_err_t s_write(jitter_buffer_t *jitter_buffer, const uint8_t *data, size_t len, bool nb)
+{
+    if (s_dtx_drop(jitter_buffer, data, len)) {
+        return ESP_OK;
+    }
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE, t_write);
+    esp_err_t ret = s_write_begin(jitter_buffer, nb);
+    if (ret != ESP_OK) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        return ret;
+    }
+
+    ret = s_write_frame(jitter_buffer, data, len, false);
+    if (ret != ESP_OK) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        s_unlock(jitter_buffer);
+        return ret;
+    }
+
+    s_adapt_on_arrival(jitter_buffer, s_write_duration_us(jitter_buffer, data, len));
+    s_check_start_playing(jitter_buffer);
+
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE, t_write);
+    s_unlock(jitter_buffer);
+    s_dtx_resume(jitter_buffer);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_write(jitter_buffer_handle_t handle, const uint8_t *data, size_t len)
+{
+    if (handle == NULL) {
+        ESP_LOGW(TAG, "Jitter buffer write: handle is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    return s_write(jitter_buffer, data, len, false);
+}
+
+esp_err_t jitter_buffer_write_nb(jitter_buffer_handle_t handle, const uint8_t *data, size_t len)
+{
+    if (handle == NULL || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    if (jitter_buffer->config.lock_free) {
+        /* lock_free 写入本身不阻塞 */
+        return s_write(jitter_buffer, data, len, false);
+    }
+    if (jitter_buffer->slots != NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
-    jitter_buffer->write_pos = 0;
-    jitter_buffer->read_pos = 0;
-    jitter_buffer->data_size = 0;
-    jitter_buffer->total_read = 0;
-    jitter_buffer->total_written = 0;
-    jitter_buffer->underrun_count = 0;
-    jitter_buffer->overrun_count = 0;
-    jitter_buffer->state = JITTER_STATE_IDLE;
-    jitter_buffer->buffer = heap_caps_calloc_prefer(1, jitter_buffer->buffer_size, 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_INTERNAL);
-    if (jitter_buffer->buffer == NULL) {
-        ESP_LOGE(TAG, "Jitter buffer create: heap_caps_calloc_prefer failed, buffer_size=%zu", jitter_buffer->buffer_size);
-        free(jitter_buffer);
-        return NULL;
+    esp_err_t ret = s_write(jitter_buffer, data, len, true);
+    if (ret != ESP_ERR_TIMEOUT) {
+        return ret;
     }
-    jitter_buffer->frame_buffer = heap_caps_calloc_prefer(1, config->frame_size, 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_INTERNAL);
-    if (jitter_buffer->frame_buffer == NULL) {
-        free(jitter_buffer->buffer);
-        ESP_LOGE(TAG, "Jitter buffer create: heap_caps_calloc_prefer failed");
-        free(jitter_buffer);
-        return NULL;
+    /* 锁被占用：暂存本帧，槽位已占用或帧过长时丢弃
+     * 先占槽位再检查帧长：reconfigure 只在槽位空闲时更换暂存槽与 frame_size */
+    uint8_t expected = JITTER_STAGE_EMPTY;
+    if (!atomic_compare_exchange_strong(&jitter_buffer->stage_state, &expected, JITTER_STAGE_FILLING)) {
+        atomic_fetch_add(&jitter_buffer->nb_dropped, 1);
+        return ESP_ERR_TIMEOUT;
     }
-    jitter_buffer->mutex = xSemaphoreCreateMutex();
-    if (jitter_buffer->mutex == NULL) {
-        free(jitter_buffer->buffer);
-        free(jitter_buffer->frame_buffer);
-        ESP_LOGE(TAG, "Jitter buffer create: xSemaphoreCreateMutex failed");
-        free(jitter_buffer);
-        return NULL;
+    if (len > jitter_buffer->config.frame_size) {
+        atomic_store(&jitter_buffer->stage_state, JITTER_STAGE_EMPTY);
+        atomic_fetch_add(&jitter_buffer->nb_dropped, 1);
+        return ESP_ERR_TIMEOUT;
     }
-    jitter_buffer->event_group = xEventGroupCreate();
-    if (jitter_buffer->event_group == NULL) {
-        vSemaphoreDelete(jitter_buffer->mutex);
-        free(jitter_buffer->buffer);
-        free(jitter_buffer->frame_buffer);
-        ESP_LOGE(TAG, "Jitter buffer create: xEventGroupCreate failed");
-        free(jitter_buffer);
-        return NULL;
+    memcpy(jitter_buffer->stage, data, len);
+    jitter_buffer->stage_len = len;
+    atomic_store(&jitter_buffer->stage_state, JITTER_STAGE_FULL);
+    atomic_fetch_add(&jitter_buffer->nb_staged, 1);
+    s_dtx_resume(jitter_buffer);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_write_batch(jitter_buffer_handle_t handle, const jitter_buffer_frame_t *frames, size_t count)
+{
+    if (handle == NULL || (frames == NULL && count > 0)) {
+        ESP_LOGW(TAG, "Jitter buffer write batch: invalid argument");
+        return ESP_ERR_INVALID_ARG;
     }
-    jitter_buffer->event_group_ack = xEventGroupCreate();
-    if (jitter_buffer->event_group_ack == NULL) {
-        vEventGroupDelete(jitter_buffer->event_group);
-        vSemaphoreDelete(jitter_buffer->mutex);
-        free(jitter_buffer->buffer);
-        free(jitter_buffer->frame_buffer);
-        ESP_LOGE(TAG, "Jitter buffer create: xEventGroupCreate(event_group_ack) failed");
-        free(jitter_buffer);
-        return NULL;
+    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    if (count == 0) {
+        return ESP_OK;
+    }
+    if (atomic_load(&jitter_buffer->dtx_suspended)) {
+        /* 挂起期间整批都是静音时丢弃 */
+        size_t i = 0;
+        while (i < count && s_dtx_is_silence(jitter_buffer, frames[i].data, frames[i].len)) {
+            i++;
+        }
+        if (i == count && s_dtx_drop(jitter_buffer, frames[0].data, frames[0].len)) {
+            return ESP_OK;
+        }
     }
-    jitter_buffer->task_handle = NULL;
-    jitter_buffer->running = true;
 
-#if (configSUPPORT_STATIC_ALLOCATION == 1) && defined(CONFIG_SPIRAM_BOOT_INIT)
-    xTaskCreatePinnedToCoreWithCaps(jitter_buffer_task,
-                                    "jitter_buffer_task",
-                                    4096,
-                                    jitter_buffer,
-                                    10,
-                                    &jitter_buffer->task_handle,
-                                    1,
-                                    (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
-#else
-    xTaskCreatePinnedToCore(jitter_buffer_task,
-                            "jitter_buffer_task",
-                            4096,
-                            jitter_buffer,
-                            10,
-                            &jitter_buffer->task_handle,
-                            1);
-#endif  /* (configSUPPORT_STATIC_ALLOCATION == 1) && defined(CONFIG_SPIRAM_BOOT_INIT) */
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE, t_write);
+    esp_err_t ret = s_write_begin(jitter_buffer, false);
+    if (ret != ESP_OK) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        return ret;
+    }
 
-    if (jitter_buffer->task_handle == NULL) {
-        ESP_LOGE(TAG, "Create jitter buffer task failed");
-        goto __err;
+    /* 按写入顺序模拟 write_pos，得到整批（含末尾填充）所需字节数 */
+    size_t pos = jitter_buffer->write_pos;
+    size_t total = 0;
+    int64_t duration_us = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = frames[i].len;
+        if (jitter_buffer->config.with_header && len >= s_header_payload_max(&jitter_buffer->config)) {
+            JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+            s_unlock(jitter_buffer);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        size_t hdr_len = jitter_buffer->config.with_header ? s_header_len(jitter_buffer, len) : 0;
+        size_t pad = 0;
+        if (jitter_buffer->config.with_header && jitter_buffer->config.contiguous_frames &&
+            jitter_buffer->buffer_size - s_ring_wrap(jitter_buffer, pos + hdr_len) < len) {
+            pad = jitter_buffer->buffer_size - pos;
+            pos = 0;
+        }
+        size_t rec_payload = jitter_buffer->config.with_header ? s_record_payload(jitter_buffer, len) : len;
+        total += pad + hdr_len + rec_payload;
+        pos = s_ring_wrap(jitter_buffer, pos + hdr_len + rec_payload);
+        duration_us += s_write_duration_us(jitter_buffer, frames[i].data, len);
     }
 
-    return (jitter_buffer_handle_t)jitter_buffer;
+    /* 放得下时一次腾出整批空间；否则（超出容量或 lock_free 空间不足）逐帧处理，与逐次 write 结果一致 */
+    size_t capacity = jitter_buffer->buffer_size - atomic_load(&jitter_buffer->borrowed);
+    bool room_made = false;
+    if (jitter_buffer->config.lock_free) {
+        room_made = total <= capacity - atomic_load(&jitter_buffer->data_size);
+    } else if (total <= capacity) {
+        room_made = s_make_room(jitter_buffer, total) == ESP_OK;
+    }
 
-__err:
-    if (jitter_buffer->event_group_ack != NULL) {
-        vEventGroupDelete(jitter_buffer->event_group_ack);
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t frame_ret = s_write_frame(jitter_buffer, frames[i].data, frames[i].len, room_made);
+        if (frame_ret != ESP_OK) {
+            ret = frame_ret;
+        }
     }
-    vEventGroupDelete(jitter_buffer->event_group);
-    vSemaphoreDelete(jitter_buffer->mutex);
-    free(jitter_buffer->buffer);
-    free(jitter_buffer->frame_buffer);
-    free(jitter_buffer);
-    return NULL;
+
+    s_adapt_on_arrival(jitter_buffer, duration_us);
+    s_check_start_playing(jitter_buffer);
+
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE, t_write);
+    s_unlock(jitter_buffer);
+    s_dtx_resume(jitter_buffer);
+    return ret;
 }
 
-esp_err_t jitter_buffer_destroy(jitter_buffer_handle_t handle)
+esp_err_t jitter_buffer_write_packet(jitter_buffer_handle_t handle, uint16_t seq, uint32_t timestamp, const uint8_t *data, size_t len)
 {
-    if (handle == NULL) {
+    if (handle == NULL || (data == NULL && len > 0)) {
+        ESP_LOGW(TAG, "Jitter buffer write packet: invalid argument");
         return ESP_ERR_INVALID_ARG;
     }
     jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    if (jitter_buffer->slots == NULL) {
+        ESP_LOGW(TAG, "Jitter buffer write packet: packet_slots is 0");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (len > jitter_buffer->config.frame_size) {
+        ESP_LOGW(TAG, "Jitter buffer write packet: len=%zu > frame_size(%u)", len, jitter_buffer->config.frame_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
 
-    xEventGroupSetBits(jitter_buffer->event_group, JITTER_BUFFER_EVENT_EXIT);
-    if (jitter_buffer->event_group_ack != NULL) {
-        xEventGroupWaitBits(jitter_buffer->event_group_ack, JITTER_BUFFER_EVENT_ACK,
-                           pdFALSE, pdFALSE, pdMS_TO_TICKS(500));
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE, t_write);
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE_LOCK, t_lock);
+    if (!s_lock_timed(jitter_buffer, jitter_buffer->config.write_timeout_ms)) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE_LOCK);
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        ESP_LOGW(TAG, "Jitter buffer write packet: mutex timeout");
+        return ESP_ERR_TIMEOUT;
     }
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE_LOCK, t_lock);
 
-    if (jitter_buffer->buffer != NULL) {
-        free(jitter_buffer->buffer);
-        jitter_buffer->buffer = NULL;
+    if (jitter_buffer->trace != NULL) {
+        s_trace(jitter_buffer, JITTER_TRACE_WRITE_PACKET, len, seq, s_get_frame_count(jitter_buffer));
     }
-    if (jitter_buffer->frame_buffer != NULL) {
-        free(jitter_buffer->frame_buffer);
-        jitter_buffer->frame_buffer = NULL;
+    uint32_t slots = jitter_buffer->config.packet_slots;
+    if (!jitter_buffer->seq_started) {
+        jitter_buffer->next_seq = seq;
+        jitter_buffer->next_index = 0;
+        jitter_buffer->highest_seq = seq;
+        jitter_buffer->seq_started = true;
     }
-    if (jitter_buffer->mutex != NULL) {
-        vSemaphoreDelete(jitter_buffer->mutex);
-        jitter_buffer->mutex = NULL;
+
+    int16_t diff = (int16_t)(seq - jitter_buffer->next_seq);
+    if (diff < 0) {
+        /* 尚未开始播放时可回拨起点，接纳首包之前到达的乱序包 */
+        int16_t span = (int16_t)(jitter_buffer->highest_seq - seq);
+        if (jitter_buffer->seq_played || span < 0 || (uint32_t)span >= slots) {
+            jitter_buffer->late_count++;
+            JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE, t_write);
+            s_unlock(jitter_buffer);
+            ESP_LOGD(TAG, "Jitter buffer write packet: late seq=%u, next=%u", seq, jitter_buffer->next_seq);
+            return ESP_OK;
+        }
+        jitter_buffer->next_index = s_slot_index(jitter_buffer, diff);
+        jitter_buffer->next_seq = seq;
+        diff = 0;
+    } else if ((uint32_t)diff >= slots) {
+        /* 超出窗口：推进播放起点，丢弃被跳过的旧包 */
+        uint16_t new_next = (uint16_t)(seq - slots + 1);
+        while (jitter_buffer->next_seq != new_next) {
+            uint32_t index = jitter_buffer->next_index;
+            if (jitter_buffer->slots[index].valid && jitter_buffer->slots[index].seq == jitter_buffer->next_seq) {
+                jitter_buffer->overrun_count++;
+                jitter_buffer->discard_count++;
+            }
+            jitter_buffer->slots[index].valid = false;
+            jitter_buffer->next_seq++;
+            jitter_buffer->next_index = s_slot_index(jitter_buffer, 1);
+        }
+        diff = (int16_t)(slots - 1);
+        ESP_LOGW(TAG, "Jitter buffer write packet: seq=%u too far ahead, window moved to %u", seq, new_next);
     }
-    if (jitter_buffer->event_group != NULL) {
-        vEventGroupDelete(jitter_buffer->event_group);
-        jitter_buffer->event_group = NULL;
+
+    uint32_t index = s_slot_index(jitter_buffer, diff);
+    jitter_packet_slot_t *slot = &jitter_buffer->slots[index];
+    if (slot->valid && slot->seq == seq) {
+        jitter_buffer->duplicate_count++;
+        JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE, t_write);
+        s_unlock(jitter_buffer);
+        return ESP_OK;
     }
-    if (jitter_buffer->event_group_ack != NULL) {
-        vEventGroupDelete(jitter_buffer->event_group_ack);
-        jitter_buffer->event_group_ack = NULL;
+    if (atomic_load(&jitter_buffer->borrowed_slot) == (int32_t)index) {
+        /* 槽位仍在输出回调中使用，不能覆盖 */
+        jitter_buffer->late_count++;
+        JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE, t_write);
+        s_unlock(jitter_buffer);
+        return ESP_OK;
     }
-    jitter_buffer->task_handle = NULL;
-    free(handle);
+
+    memcpy(jitter_buffer->buffer + (size_t)index * jitter_buffer->config.frame_size, data, len);
+    slot->seq = seq;
+    slot->timestamp = timestamp;
+    slot->len = (uint16_t)len;
+    slot->valid = true;
+    jitter_buffer->total_written += len;
+    if (!atomic_load(&jitter_buffer->sample_pending)) {
+        jitter_buffer->sample_seq = seq;
+        jitter_buffer->sample_time_us = esp_timer_get_time();
+        atomic_store(&jitter_buffer->sample_pending, true);
+    }
+    if ((int16_t)(seq - jitter_buffer->highest_seq) > 0) {
+        jitter_buffer->highest_seq = seq;
+    }
+
+    if (jitter_buffer->config.adaptive_delay) {
+        jitter_buffer->expected_us = (int64_t)(int16_t)(seq - jitter_buffer->last_arrival_seq) * jitter_buffer->config.frame_interval * 1000;
+        jitter_buffer->last_arrival_seq = seq;
+        s_adapt_on_arrival(jitter_buffer, 0);
+    }
+    s_check_start_playing(jitter_buffer);
+
+    JITTER_PROF_END(jitter_buffer, JITTER_PROFILE_WRITE, t_write);
+    s_unlock(jitter_buffer);
     return ESP_OK;
 }
 
-esp_err_t jitter_buffer_reset(jitter_buffer_handle_t handle)
+/* 预留写空间：with_header 时 payload 位于头之后；contiguous 要求 payload 不跨越缓冲末尾 */
+static esp_err_t s_write_reserve(jitter_buffer_t *jb, size_t max_len, bool contiguous, jitter_buffer_span_t spans[2])
 {
-    if (handle == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    size_t hdr_len = jb->config.with_header ? s_header_len(jb, max_len) : 0;
+    if (jb->slots != NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
-    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
-    if (xSemaphoreTake(jitter_buffer->mutex, pdMS_TO_TICKS(500)) != pdTRUE) {
-        ESP_LOGW(TAG, "Jitter buffer reset: mutex timeout");
+    if (jb->config.with_header && max_len > jb->config.frame_size) {
+        ESP_LOGW(TAG, "Jitter buffer reserve: max_len=%zu > max_payload(%u)", max_len, jb->config.frame_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!s_lock_timed(jb, jb->config.write_timeout_ms)) {
+        ESP_LOGW(TAG, "Jitter buffer reserve: mutex timeout");
         return ESP_ERR_TIMEOUT;
     }
-    jitter_buffer->write_pos = 0;
-    jitter_buffer->read_pos = 0;
-    jitter_buffer->data_size = 0;
-    jitter_buffer->state = JITTER_STATE_BUFFERING;
-    s_post_state_event(jitter_buffer, JITTER_EVENT_BUFFERING);
-    xSemaphoreGive(jitter_buffer->mutex);
+    if (jb->reserved) {
+        s_unlock(jb);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stage_merge(jb);
+
+    size_t pad = 0;
+    size_t payload_pos = s_ring_wrap(jb, jb->write_pos + hdr_len);
+    if (contiguous && jb->buffer_size - payload_pos < max_len) {
+        if (!jb->config.with_header) {
+            /* 无头格式是连续字节流，无法在末尾填充 */
+            s_unlock(jb);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        /* 提交时写入填充标记，payload 从缓冲起始处开始 */
+        pad = s_wrap_pad(jb, hdr_len, max_len);
+        payload_pos = s_frame_payload_pos(jb, pad, hdr_len);
+    }
+
+    esp_err_t ret = s_make_room(jb, pad + hdr_len + (jb->config.with_header ? s_record_payload(jb, max_len) : max_len));
+    if (ret != ESP_OK) {
+        s_unlock(jb);
+        return ret;
+    }
+
+    size_t first = jb->buffer_size - payload_pos;
+    if (first > max_len) {
+        first = max_len;
+    }
+    spans[0].data = jb->buffer + payload_pos;
+    spans[0].len = first;
+    spans[1].data = (max_len > first) ? jb->buffer : NULL;
+    spans[1].len = max_len - first;
+    jb->reserve_len = max_len;
+    jb->reserve_pad = pad;
+    jb->reserve_hdr_len = hdr_len;
+    jb->reserved = true;
+    s_unlock(jb);
     return ESP_OK;
 }
 
-esp_err_t jitter_buffer_write(jitter_buffer_handle_t handle, const uint8_t *data, size_t len)
+esp_err_t jitter_buffer_write_reserve(jitter_buffer_handle_t handle, size_t max_len, uint8_t **ptr)
 {
-    if (handle == NULL) {
-        ESP_LOGW(TAG, "Jitter buffer write: handle is NULL");
+    if (handle == NULL || ptr == NULL || max_len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
-    jitter_buffer_t *jitter_buffer = (jitter_buffer_t *)handle;
+    jitter_buffer_span_t spans[2];
+    esp_err_t ret = s_write_reserve((jitter_buffer_t *)handle, max_len, true, spans);
+    if (ret == ESP_OK) {
+        *ptr = spans[0].data;
+    }
+    return ret;
+}
 
-    if (jitter_buffer->buffer == NULL || jitter_buffer->mutex == NULL) {
-        ESP_LOGW(TAG, "Jitter buffer write: buffer or mutex is NULL");
+esp_err_t jitter_buffer_write_reserve_spans(jitter_buffer_handle_t handle, size_t max_len, jitter_buffer_span_t spans[2])
+{
+    if (handle == NULL || spans == NULL || max_len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
+    return s_write_reserve((jitter_buffer_t *)handle, max_len, false, spans);
+}
 
-    if (xSemaphoreTake(jitter_buffer->mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
-        ESP_LOGW(TAG, "Jitter buffer write: mutex timeout");
+esp_err_t jitter_buffer_write_commit(jitter_buffer_handle_t handle, size_t actual_len)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE, t_write);
+    JITTER_PROF_BEGIN(JITTER_PROFILE_WRITE_LOCK, t_lock);
+    if (!s_lock_timed(jb, jb->config.write_timeout_ms)) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE_LOCK);
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        ESP_LOGW(TAG, "Jitter buffer commit: mutex timeout");
         return ESP_ERR_TIMEOUT;
     }
-
-    size_t write_len = len;
-    if (jitter_buffer->config.with_header) {
-        write_len = JITTER_HEADER_LEN + len;  /* 2 字节长度 + payload */
-    }
-
-    size_t available_space = jitter_buffer->buffer_size - jitter_buffer->data_size;
-    if (write_len > available_space) {
-        if (jitter_buffer->config.with_header) {
-            /* 带头格式必须按整帧丢弃，否则 read_pos 会错位，后续会把 payload 当长度解析 */
-            size_t discarded_frames = 0;
-            while (available_space < write_len && jitter_buffer->data_size >= JITTER_HEADER_LEN) {
-                uint8_t b0 = jitter_buffer->buffer[jitter_buffer->read_pos];
-                uint8_t b1 = jitter_buffer->buffer[(jitter_buffer->read_pos + 1) % jitter_buffer->buffer_size];
-                uint16_t L = (uint16_t)((b0 << 8) | b1);
-                if (L > jitter_buffer->buffer_size / 2) {
-                    break;
-                }
-                if (jitter_buffer->data_size < JITTER_HEADER_LEN + L) {
-                    break;
-                }
-                jitter_buffer->read_pos = (jitter_buffer->read_pos + JITTER_HEADER_LEN + L) % jitter_buffer->buffer_size;
-                jitter_buffer->data_size -= (JITTER_HEADER_LEN + L);
-                discarded_frames++;
-                available_space = jitter_buffer->buffer_size - jitter_buffer->data_size;
-            }
-            if (available_space < write_len) {
-                size_t discard = write_len - available_space;
-                jitter_buffer->read_pos = (jitter_buffer->read_pos + discard) % jitter_buffer->buffer_size;
-                jitter_buffer->data_size -= discard;
-                ESP_LOGW(TAG, "Jitter buffer overrun: alignment lost, discarded %zu bytes (frames=%zu)",
-                         discard, (unsigned long)discarded_frames);
-            }
-            jitter_buffer->overrun_count++;
-            if (discarded_frames > 0) {
-                ESP_LOGW(TAG, "Jitter buffer overrun: discarded %zu frame(s), count=%lu, write_len=%zu",
-                         (unsigned long)discarded_frames, (unsigned long)jitter_buffer->overrun_count, write_len);
-            }
-        } else {
-            size_t discard = write_len - available_space;
-            jitter_buffer->read_pos = (jitter_buffer->read_pos + discard) % jitter_buffer->buffer_size;
-            jitter_buffer->data_size -= discard;
-            jitter_buffer->overrun_count++;
-            ESP_LOGW(TAG, "Jitter buffer overrun: discarded %zu bytes, count=%lu, len=%zu, available_space=%zu",
-                     discard, (unsigned long)jitter_buffer->overrun_count, write_len, available_space);
-        }
+    JITTER_PROF_END(jb, JITTER_PROFILE_WRITE_LOCK, t_lock);
+    if (!jb->reserved) {
+        /* 未预留，或预留期间被 reset */
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        s_unlock(jb);
+        return ESP_ERR_INVALID_STATE;
     }
-
-    if (jitter_buffer->config.with_header) {
-        uint8_t hdr[JITTER_HEADER_LEN];
-        hdr[0] = (uint8_t)((len >> 8) & 0xff);
-        hdr[1] = (uint8_t)(len & 0xff);
-        s_ring_write(jitter_buffer, hdr, JITTER_HEADER_LEN);
-        s_ring_write(jitter_buffer, data, len);
-    } else {
-        s_ring_write(jitter_buffer, data, len);
+    if (actual_len > jb->reserve_len ||
+        (jb->config.align_frames && !jb->config.with_header && actual_len % JITTER_ALIGN != 0)) {
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        s_unlock(jb);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    jb->reserved = false;
+    if (actual_len == 0 || s_dtx_drop(jb, NULL, actual_len)) {
+        /* 取消预留，不写入任何数据；dtx 挂起期间的 Opus DTX 包同样丢弃 */
+        JITTER_PROF_DROP(JITTER_PROFILE_WRITE);
+        s_unlock(jb);
+        return ESP_OK;
     }
 
-    size_t frame_count = jitter_buffer->config.with_header
-        ? s_get_frame_count_with_header(jitter_buffer)
-        : (jitter_buffer->data_size / jitter_buffer->config.frame_size);
-
-    // 状态机：达到高水位开始播放
-    if (jitter_buffer->state == JITTER_STATE_BUFFERING ||
-        jitter_buffer->state == JITTER_STATE_UNDERRUN) {
-        if (frame_count >= jitter_buffer->config.high_water) {
-            jitter_buffer->state = JITTER_STATE_PLAYING;
-            s_post_state_event(jitter_buffer, JITTER_EVENT_PLAYING);
-            ESP_LOGI(TAG, "Jitter buffer: start playing, frames=%zu", frame_count);
+    s_trace_write(jb, actual_len, s_get_frame_count(jb));
+    int64_t duration_us = s_write_duration_us(jb, NULL, actual_len);
+    if (jb->config.with_header) {
+        uint32_t opus_us = s_ring_opus_us(jb, s_frame_payload_pos(jb, jb->reserve_pad, jb->reserve_hdr_len), actual_len);
+        if (opus_us > 0) {
+            duration_us = opus_us;
         }
+        s_publish_frame(jb, jb->reserve_pad, jb->reserve_hdr_len, actual_len);
+    } else {
+        s_ring_publish(jb, actual_len);
     }
+    s_sample_arrival(jb);
 
-    xSemaphoreGive(jitter_buffer->mutex);
+    s_adapt_on_arrival(jb, duration_us);
+    s_check_start_playing(jb);
+
+    JITTER_PROF_END(jb, JITTER_PROFILE_WRITE, t_write);
+    s_unlock(jb);
+    s_dtx_resume(jb);
     return ESP_OK;
 }
 
@@ -620,8 +3296,15 @@ esp_err_t jitter_buffer_start(jitter_buffer_handle_t handle)
         return ESP_ERR_INVALID_ARG;
     }
     jitter_buffer_t *jb = (jitter_buffer_t *)handle;
-    jb->state = JITTER_STATE_BUFFERING;  /* 启动后先蓄水，达到 high_water 再播放 */
-    s_post_state_event(jb, JITTER_EVENT_BUFFERING);
+    jb->fast_start = jb->config.start_water > 0;
+    jb->state = JITTER_STATE_BUFFERING;  /* 启动后先蓄水，达到 high_water（快速起播时为 start_water）再播放 */
+    s_defer_flush(jb);
+    s_post_state_event(jb, JITTER_EVENT_BUFFERING, pdMS_TO_TICKS(100));
+    if (jb->config.scheduler != NULL || jb->config.clock_source == JITTER_CLOCK_PULL) {
+        atomic_store(&jb->active, true);
+        ESP_LOGI(TAG, "Jitter buffer start");
+        return ESP_OK;
+    }
     if (jb->event_group_ack != NULL) {
         xEventGroupClearBits(jb->event_group_ack, JITTER_BUFFER_EVENT_ACK);
     }
@@ -630,6 +3313,10 @@ esp_err_t jitter_buffer_start(jitter_buffer_handle_t handle)
         xEventGroupWaitBits(jb->event_group_ack, JITTER_BUFFER_EVENT_ACK,
                            pdFALSE, pdFALSE, pdMS_TO_TICKS(500));
     }
+    if (jb->clock_timer != NULL) {
+        esp_timer_start_periodic(jb->clock_timer, (uint64_t)jb->config.frame_interval * 1000);
+    }
+    atomic_store(&jb->active, true);
     ESP_LOGI(TAG, "Jitter buffer start");
     return ESP_OK;
 }
@@ -640,13 +3327,276 @@ esp_err_t jitter_buffer_stop(jitter_buffer_handle_t handle)
         return ESP_ERR_INVALID_ARG;
     }
     jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    if (jb->config.scheduler != NULL) {
+        /* 等待调度器当前一拍结束，返回后不再有输出回调 */
+        atomic_store(&jb->active, false);
+        jitter_buffer_scheduler_sync(jb->config.scheduler);
+        return ESP_OK;
+    }
+    if (jb->config.clock_source == JITTER_CLOCK_PULL) {
+        atomic_store(&jb->active, false);
+        return ESP_OK;
+    }
     if (jb->event_group_ack != NULL) {
         xEventGroupClearBits(jb->event_group_ack, JITTER_BUFFER_EVENT_ACK);
     }
+    if (jb->clock_timer != NULL) {
+        esp_timer_stop(jb->clock_timer);
+    }
+    atomic_store(&jb->active, false);
     xEventGroupSetBits(jb->event_group, JITTER_BUFFER_EVENT_STOP);
+    s_clock_wake(jb);
     if (jb->event_group_ack != NULL) {
         xEventGroupWaitBits(jb->event_group_ack, JITTER_BUFFER_EVENT_ACK,
                            pdFALSE, pdFALSE, pdMS_TO_TICKS(500));
     }
     return ESP_OK;
 }
+
+esp_err_t jitter_buffer_get_stats(jitter_buffer_handle_t handle, jitter_buffer_stats_t *stats)
+{
+    if (handle == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    /* lock_free 模式下不加锁，各计数为近似快照 */
+    if (!s_lock(jb, pdMS_TO_TICKS(JITTER_LOCK_TIMEOUT_MS))) {
+        ESP_LOGW(TAG, "Jitter buffer get stats: mutex timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->underrun_count = jb->underrun_count;
+    stats->overrun_count = jb->overrun_count;
+    stats->total_written = jb->total_written;
+    stats->total_read = jb->total_read;
+    stats->depth_frames = (uint32_t)s_get_frame_count(jb);
+    if (jb->slots != NULL) {
+        for (uint32_t i = 0; i < jb->config.packet_slots; i++) {
+            if (jb->slots[i].valid) {
+                stats->depth_bytes += jb->slots[i].len;
+            }
+        }
+    } else {
+        stats->depth_bytes = atomic_load(&jb->data_size);
+    }
+    if (jb->depth_samples > 0) {
+        stats->depth_min = jb->depth_min;
+        stats->depth_max = jb->depth_max;
+        stats->depth_avg = (uint32_t)(jb->depth_sum / jb->depth_samples);
+    }
+    stats->high_water = atomic_load(&jb->high_water);
+    stats->low_water = atomic_load(&jb->low_water);
+    stats->concealed_frames = jb->conceal_count_total;
+    stats->discarded_frames = jb->discard_count;
+    stats->adaptive_drops = jb->adapt_drop_count;
+    stats->overrun_drop_oldest = jb->drop_oldest_count;
+    stats->overrun_drop_newest = jb->drop_newest_count;
+    stats->overrun_compressed = jb->compress_count;
+    stats->drift_inserted = jb->drift_inserted;
+    stats->drift_deleted = jb->drift_deleted;
+    stats->late_packets = jb->late_count;
+    stats->duplicate_packets = jb->duplicate_count;
+    stats->lost_packets = jb->lost_count;
+    stats->lock_timeouts = atomic_load(&jb->lock_timeouts);
+    stats->write_nb_staged = atomic_load(&jb->nb_staged);
+    stats->write_nb_dropped = atomic_load(&jb->nb_dropped);
+    stats->dtx_suspends = jb->dtx_suspends;
+    stats->dtx_dropped = atomic_load(&jb->dtx_dropped);
+    stats->events_dropped = atomic_load(&jb->events_dropped);
+#if defined(CONFIG_JITTER_BUFFER_PROFILE)
+    for (int i = 0; i < JITTER_PROFILE_MAX; i++) {
+        const jitter_prof_acc_t *acc = &jb->prof[i];
+        stats->profile[i].count = acc->count;
+        stats->profile[i].min = acc->min;
+        stats->profile[i].max = acc->max;
+        stats->profile[i].avg = acc->count > 0 ? (uint32_t)(acc->sum / acc->count) : 0;
+    }
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE) */
+    memcpy(stats->residence_hist, jb->residence_hist, sizeof(stats->residence_hist));
+    s_unlock(jb);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_reset_stats(jitter_buffer_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    if (!s_lock(jb, pdMS_TO_TICKS(JITTER_LOCK_TIMEOUT_MS))) {
+        ESP_LOGW(TAG, "Jitter buffer reset stats: mutex timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+    /* total_read/total_written 在 lock_free 模式下参与 reset 定位，不清零 */
+    jb->underrun_count = 0;
+    jb->overrun_count = 0;
+    jb->depth_min = UINT32_MAX;
+    jb->depth_max = 0;
+    jb->depth_sum = 0;
+    jb->depth_samples = 0;
+    jb->conceal_count_total = 0;
+    jb->discard_count = 0;
+    jb->adapt_drop_count = 0;
+    jb->drop_oldest_count = 0;
+    jb->drop_newest_count = 0;
+    jb->compress_count = 0;
+    jb->drift_inserted = 0;
+    jb->drift_deleted = 0;
+    jb->late_count = 0;
+    jb->duplicate_count = 0;
+    jb->lost_count = 0;
+    atomic_store(&jb->lock_timeouts, 0);
+    atomic_store(&jb->nb_staged, 0);
+    atomic_store(&jb->nb_dropped, 0);
+    jb->dtx_suspends = 0;
+    atomic_store(&jb->dtx_dropped, 0);
+    atomic_store(&jb->events_dropped, 0);
+#if defined(CONFIG_JITTER_BUFFER_PROFILE)
+    memset(jb->prof, 0, sizeof(jb->prof));
+#endif  /* defined(CONFIG_JITTER_BUFFER_PROFILE) */
+    memset(jb->residence_hist, 0, sizeof(jb->residence_hist));
+    s_unlock(jb);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_clock_tick(jitter_buffer_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    if (jb->config.clock_source != JITTER_CLOCK_EXTERNAL || jb->task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xTaskNotifyGive(jb->task_handle);
+    return ESP_OK;
+}
+
+void IRAM_ATTR jitter_buffer_clock_tick_from_isr(jitter_buffer_handle_t handle, BaseType_t *higher_priority_task_woken)
+{
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    vTaskNotifyGiveFromISR(jb->task_handle, higher_priority_task_woken);
+}
+
+esp_err_t jitter_buffer_read(jitter_buffer_handle_t handle, uint8_t *out, size_t max_len, size_t *out_len)
+{
+    if (handle == NULL || out == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    *out_len = 0;
+    if (jb->config.clock_source != JITTER_CLOCK_PULL || !atomic_load(&jb->active)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (max_len < jb->config.frame_size) {
+        ESP_LOGW(TAG, "Jitter buffer read: max_len=%zu < frame_size(%u)", max_len, jb->config.frame_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t ret = s_jitter_buffer_pull(jb, out, max_len, out_len);
+    s_defer_flush(jb);
+    return ret;
+}
+
+esp_err_t jitter_buffer_trace_read(jitter_buffer_handle_t handle, jitter_buffer_trace_entry_t *entries, size_t max_count,
+                                   size_t *count)
+{
+    if (handle == NULL || count == NULL || (entries == NULL && max_count > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    *count = 0;
+    if (jb->trace == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    uint32_t n = jb->config.trace_entries;
+    /* 分块拷出，每次临界区最多 JITTER_TRACE_CHUNK 条 */
+    while (*count < max_count) {
+        size_t chunk = max_count - *count;
+        if (chunk > JITTER_TRACE_CHUNK) {
+            chunk = JITTER_TRACE_CHUNK;
+        }
+        portENTER_CRITICAL(&jb->trace_lock);
+        if (chunk > jb->trace_count) {
+            chunk = jb->trace_count;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            entries[*count + i] = jb->trace[jb->trace_start];
+            jb->trace_start = (jb->trace_start + 1) % n;
+        }
+        jb->trace_count -= chunk;
+        portEXIT_CRITICAL(&jb->trace_lock);
+        if (chunk == 0) {
+            break;
+        }
+        *count += chunk;
+    }
+    return ESP_OK;
+}
+
+/* hex 模式每行 32 字节，带 "jbtr:" 前缀以便从串口日志中筛出 */
+static bool s_trace_emit(FILE *out, const void *data, size_t len, bool hex)
+{
+    if (!hex) {
+        return fwrite(data, 1, len, out) == len;
+    }
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t off = 0; off < len; off += 32) {
+        size_t line = len - off < 32 ? len - off : 32;
+        if (fputs("jbtr:", out) < 0) {
+            return false;
+        }
+        for (size_t i = 0; i < line; i++) {
+            fprintf(out, "%02x", p[off + i]);
+        }
+        if (fputc('\n', out) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t jitter_buffer_trace_dump(jitter_buffer_handle_t handle, FILE *out, bool hex)
+{
+    if (handle == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_t *jb = (jitter_buffer_t *)handle;
+    if (jb->trace == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    jitter_buffer_trace_header_t hdr = {
+        .magic = { 'J', 'B', 'T', 'R' },
+        .version = JITTER_TRACE_VERSION,
+        .entry_size = sizeof(jitter_buffer_trace_entry_t),
+        .flags = (jb->config.with_header ? 0x01 : 0) | (jb->slots != NULL ? 0x02 : 0),
+        .frame_interval = (uint16_t)jb->config.frame_interval,
+        .high_water = (uint16_t)atomic_load(&jb->high_water),
+        .low_water = (uint16_t)atomic_load(&jb->low_water),
+        .frame_size = jb->config.frame_size,
+    };
+    /* 只导出此刻已有的记录，导出期间新增的留到下次 */
+    portENTER_CRITICAL(&jb->trace_lock);
+    hdr.count = jb->trace_count;
+    hdr.lost = jb->trace_lost;
+    portEXIT_CRITICAL(&jb->trace_lock);
+    if (!s_trace_emit(out, &hdr, sizeof(hdr), hex)) {
+        return ESP_FAIL;
+    }
+
+    jitter_buffer_trace_entry_t chunk[JITTER_TRACE_CHUNK];
+    uint32_t remaining = hdr.count;
+    while (remaining > 0) {
+        size_t got;
+        jitter_buffer_trace_read(handle, chunk, remaining < JITTER_TRACE_CHUNK ? remaining : JITTER_TRACE_CHUNK, &got);
+        if (got == 0) {
+            break;
+        }
+        if (!s_trace_emit(out, chunk, got * sizeof(chunk[0]), hex)) {
+            return ESP_FAIL;
+        }
+        remaining -= got;
+    }
+    fflush(out);
+    return ESP_OK;
+}
@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+#include "jitter_buffer_pool.h"
+#include "jitter_buffer_priv.h"
+
+static const char *TAG = "JITTER_POOL";
+
+typedef struct {
+    jitter_buffer_handle_t handle;
+    _Atomic bool           in_use;
+} jitter_pool_item_t;
+
+typedef struct {
+    uint32_t           count;
+    jitter_pool_item_t items[];  /* 创建后不再变化，取用/归还只修改 in_use */
+} jitter_buffer_pool_t;
+
+static jitter_pool_item_t *s_pool_find(jitter_buffer_pool_t *pool, jitter_buffer_handle_t jb)
+{
+    for (uint32_t i = 0; i < pool->count; i++) {
+        if (pool->items[i].handle == jb) {
+            return &pool->items[i];
+        }
+    }
+    return NULL;
+}
+
+jitter_buffer_pool_handle_t jitter_buffer_pool_create(const jitter_buffer_config_t *config, uint32_t count)
+{
+    if (config == NULL || count == 0 || (config->user_buffer != NULL && count > 1)) {
+        ESP_LOGE(TAG, "Jitter buffer pool create: invalid config, count=%lu", (unsigned long)count);
+        return NULL;
+    }
+    jitter_buffer_pool_t *pool = (jitter_buffer_pool_t *)calloc(1, sizeof(jitter_buffer_pool_t) + count * sizeof(jitter_pool_item_t));
+    if (pool == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer pool create: calloc failed, count=%lu", (unsigned long)count);
+        return NULL;
+    }
+    /* 一次性创建全部实例，之后每次会话只取用/归还，不再分配 */
+    for (uint32_t i = 0; i < count; i++) {
+        pool->items[i].handle = jitter_buffer_create(config);
+        if (pool->items[i].handle == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer pool create: instance %lu create failed", (unsigned long)i);
+            goto __err;
+        }
+        jitter_buffer_priv_set_pooled(pool->items[i].handle);
+        atomic_init(&pool->items[i].in_use, false);
+        pool->count++;
+    }
+    return (jitter_buffer_pool_handle_t)pool;
+
+__err:
+    for (uint32_t i = 0; i < pool->count; i++) {
+        jitter_buffer_destroy(pool->items[i].handle);
+    }
+    free(pool);
+    return NULL;
+}
+
+esp_err_t jitter_buffer_pool_destroy(jitter_buffer_pool_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_pool_t *pool = (jitter_buffer_pool_t *)handle;
+    for (uint32_t i = 0; i < pool->count; i++) {
+        if (atomic_load(&pool->items[i].in_use)) {
+            ESP_LOGW(TAG, "Jitter buffer pool destroy: instance %lu is still acquired", (unsigned long)i);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    for (uint32_t i = 0; i < pool->count; i++) {
+        jitter_buffer_destroy(pool->items[i].handle);
+    }
+    free(pool);
+    return ESP_OK;
+}
+
+jitter_buffer_handle_t jitter_buffer_pool_acquire(jitter_buffer_pool_handle_t handle)
+{
+    if (handle == NULL) {
+        return NULL;
+    }
+    jitter_buffer_pool_t *pool = (jitter_buffer_pool_t *)handle;
+    for (uint32_t i = 0; i < pool->count; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&pool->items[i].in_use, &expected, true)) {
+            return pool->items[i].handle;
+        }
+    }
+    ESP_LOGW(TAG, "Jitter buffer pool acquire: all %lu instances in use", (unsigned long)pool->count);
+    return NULL;
+}
+
+esp_err_t jitter_buffer_pool_release(jitter_buffer_pool_handle_t handle, jitter_buffer_handle_t jb)
+{
+    if (handle == NULL || jb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_pool_item_t *item = s_pool_find((jitter_buffer_pool_t *)handle, jb);
+    if (item == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!atomic_load(&item->in_use)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* 先回收再标记空闲，取用方拿到的总是已清空的实例 */
+    jitter_buffer_priv_recycle(jb);
+    atomic_store(&item->in_use, false);
+    return ESP_OK;
+}
+
+uint32_t jitter_buffer_pool_available(jitter_buffer_pool_handle_t handle)
+{
+    if (handle == NULL) {
+        return 0;
+    }
+    jitter_buffer_pool_t *pool = (jitter_buffer_pool_t *)handle;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < pool->count; i++) {
+        n += !atomic_load(&pool->items[i].in_use);
+    }
+    return n;
+}
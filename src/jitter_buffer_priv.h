@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "jitter_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 组件内部接口，jitter_buffer.c 与 jitter_buffer_scheduler.c、jitter_buffer_pool.c 之间使用，不对外导出 */
+
+/* 创建播放/调度任务；stack_caps 为 0 时启用 PSRAM 则栈放在 PSRAM，否则使用默认分配
+ * *with_caps 返回是否以 xTaskCreatePinnedToCoreWithCaps() 创建，退出与删除时按它选择接口 */
+void jitter_buffer_priv_task_create(TaskFunction_t fn, const char *name, void *arg, uint32_t stack, uint32_t prio,
+                                    int core, uint32_t stack_caps, TaskHandle_t *handle, bool *with_caps);
+
+/* 任务函数末尾调用（发出退出信号之后，不再访问实例）：普通任务自行删除，WithCaps 任务挂起等待 jitter_buffer_priv_task_delete() */
+void jitter_buffer_priv_task_exit(bool with_caps);
+
+/* destroy 收到任务的退出信号后调用：WithCaps 任务挂起后以 vTaskDeleteWithCaps() 释放栈与 TCB，普通任务已自行删除 */
+void jitter_buffer_priv_task_delete(TaskHandle_t handle, bool with_caps);
+
+/* 调度器每拍调用：已 start 的实例输出一帧（或隐藏帧/静音），未 start 时直接返回 */
+void jitter_buffer_priv_tick(jitter_buffer_handle_t handle);
+
+/* 混音调度器每拍调用：已 start 的实例取一帧到 out，未 start 时返回 ESP_ERR_NOT_FOUND */
+esp_err_t jitter_buffer_priv_pull(jitter_buffer_handle_t handle, uint8_t *out, size_t max_len, size_t *out_len);
+
+/* 实例池回收：未 stop 时先 stop，再清空缓冲、统计与 trace，水位与播放状态恢复为刚创建时，保留任务与所有内存 */
+void jitter_buffer_priv_recycle(jitter_buffer_handle_t handle);
+
+/* 标记为池中实例：各会话共用创建时的配置，jitter_buffer_reconfigure() 返回 ESP_ERR_NOT_SUPPORTED */
+void jitter_buffer_priv_set_pooled(jitter_buffer_handle_t handle);
+
+/* 将实例加入调度器，frame_interval 必须与调度器一致；混音调度器还要求 16 位 PCM 且 frame_size 等于 mix_frame_size */
+esp_err_t jitter_buffer_scheduler_add(jitter_buffer_scheduler_handle_t sched, jitter_buffer_handle_t handle,
+                                      const jitter_buffer_config_t *config);
+
+/* 调度器是否为混音模式（mix_frame_size > 0），此时实例不需要输出回调 */
+bool jitter_buffer_scheduler_mixing(jitter_buffer_scheduler_handle_t sched);
+
+/* 将实例移出调度器；等待当前一拍结束后返回，不能在输出回调中调用 */
+void jitter_buffer_scheduler_remove(jitter_buffer_scheduler_handle_t sched, jitter_buffer_handle_t handle);
+
+/* 等待调度器当前一拍结束；在调度器任务内调用时直接返回 */
+void jitter_buffer_scheduler_sync(jitter_buffer_scheduler_handle_t sched);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,291 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+
+#include "jitter_buffer_scheduler.h"
+#include "jitter_buffer_priv.h"
+
+#define JITTER_SCHEDULER_EVENT_EXITED (1 << 0)
+
+#define JITTER_MIX_SCRATCH_SLACK 16  /* 取帧缓冲多留的字节，供 drift_compensation 多读一个采样帧（最多 8 声道） */
+
+static const char *TAG = "JITTER_SCHEDULER";
+
+typedef struct {
+    jitter_buffer_scheduler_config_t config;
+    jitter_buffer_handle_t          *streams;       /* 按加入顺序排列，每拍依次输出 */
+    uint32_t                        *gains;         /* 混音模式：与 streams 对应的 Q12 增益 */
+    uint32_t                         stream_count;
+    int16_t                         *mix;           /* 混音模式：本拍混音结果，仅调度器任务访问 */
+    uint8_t                         *scratch;       /* 混音模式：逐路取帧的缓冲 */
+    size_t                           scratch_size;
+    SemaphoreHandle_t                mutex;         /* 保护 streams，一拍的输出期间持有 */
+    EventGroupHandle_t               event_group;
+    TaskHandle_t                     task_handle;
+    bool                             task_with_caps; /* 以 WithCaps 创建，destroy 时需 vTaskDeleteWithCaps() */
+    _Atomic bool                     running;
+} jitter_buffer_scheduler_t;
+
+/* 饱和混音：acc += in * gain（Q12），逐样本钳位到 int16；单位增益时省去乘法
+ * 循环保持简单、无分支依赖，便于编译器展开/向量化 */
+static void s_mix_s16(int16_t *restrict acc, const int16_t *restrict in, size_t samples, uint32_t gain_q12)
+{
+    if (gain_q12 == JITTER_MIX_GAIN_UNITY) {
+        for (size_t i = 0; i < samples; i++) {
+            int32_t v = (int32_t)acc[i] + in[i];
+            acc[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+        }
+        return;
+    }
+    int32_t gain = (int32_t)gain_q12;
+    for (size_t i = 0; i < samples; i++) {
+        int32_t v = (int32_t)acc[i] + ((in[i] * gain) >> 12);
+        acc[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+    }
+}
+
+/* 混音模式的一拍：逐路取一帧叠加，无帧（蓄水、欠载、未 start）的路按静音处理，不做任何分配 */
+static void s_mix_tick(jitter_buffer_scheduler_t *sched)
+{
+    size_t frame_size = sched->config.mix_frame_size;
+    memset(sched->mix, 0, frame_size);
+    for (uint32_t i = 0; i < sched->stream_count; i++) {
+        size_t len;
+        if (jitter_buffer_priv_pull(sched->streams[i], sched->scratch, sched->scratch_size, &len) != ESP_OK ||
+            sched->gains[i] == 0) {
+            continue;
+        }
+        if (len > frame_size) {
+            len = frame_size;
+        }
+        /* scratch 由 calloc 分配，满足 int16 对齐 */
+        s_mix_s16(sched->mix, (const int16_t *)sched->scratch, len / sizeof(int16_t), sched->gains[i]);
+    }
+}
+
+static void jitter_buffer_scheduler_task(void *arg)
+{
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)arg;
+    TickType_t last_wake_time = xTaskGetTickCount();
+    while (atomic_load(&sched->running)) {
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(sched->config.frame_interval));
+        xSemaphoreTake(sched->mutex, portMAX_DELAY);
+        if (sched->mix != NULL) {
+            s_mix_tick(sched);
+        } else {
+            for (uint32_t i = 0; i < sched->stream_count; i++) {
+                jitter_buffer_priv_tick(sched->streams[i]);
+            }
+        }
+        xSemaphoreGive(sched->mutex);
+        if (sched->mix != NULL) {
+            sched->config.on_mix_output(sched->mix, sched->config.mix_frame_size, sched->config.ctx);
+        }
+        if (sched->config.on_tick != NULL) {
+            sched->config.on_tick(sched->config.ctx);
+        }
+    }
+    ESP_LOGI(TAG, "Jitter buffer scheduler task exit");
+    bool with_caps = sched->task_with_caps;  /* EXITED 之后 destroy 可能已释放 sched */
+    xEventGroupSetBits(sched->event_group, JITTER_SCHEDULER_EVENT_EXITED);
+    jitter_buffer_priv_task_exit(with_caps);
+}
+
+jitter_buffer_scheduler_handle_t jitter_buffer_scheduler_create(const jitter_buffer_scheduler_config_t *config)
+{
+    if (config == NULL || config->frame_interval == 0 || config->max_streams == 0 || config->task_stack == 0) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler create: invalid config");
+        return NULL;
+    }
+    if (config->mix_frame_size > 0 && (config->on_mix_output == NULL || config->mix_frame_size % sizeof(int16_t) != 0)) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler create: mixer needs on_mix_output and an even mix_frame_size");
+        return NULL;
+    }
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)calloc(1, sizeof(jitter_buffer_scheduler_t));
+    if (sched == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler create: calloc failed");
+        return NULL;
+    }
+    sched->config = *config;
+    sched->streams = (jitter_buffer_handle_t *)calloc(config->max_streams, sizeof(jitter_buffer_handle_t));
+    if (sched->streams == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler create: calloc streams failed, max_streams=%lu", (unsigned long)config->max_streams);
+        goto __err;
+    }
+    if (config->mix_frame_size > 0) {
+        sched->gains = (uint32_t *)calloc(config->max_streams, sizeof(uint32_t));
+        sched->mix = (int16_t *)calloc(1, config->mix_frame_size);
+        sched->scratch_size = config->mix_frame_size + JITTER_MIX_SCRATCH_SLACK;
+        sched->scratch = (uint8_t *)calloc(1, sched->scratch_size);
+        if (sched->gains == NULL || sched->mix == NULL || sched->scratch == NULL) {
+            ESP_LOGE(TAG, "Jitter buffer scheduler create: calloc mix buffers failed, mix_frame_size=%lu",
+                     (unsigned long)config->mix_frame_size);
+            goto __err;
+        }
+    }
+    sched->mutex = xSemaphoreCreateMutex();
+    if (sched->mutex == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler create: xSemaphoreCreateMutex failed");
+        goto __err;
+    }
+    sched->event_group = xEventGroupCreate();
+    if (sched->event_group == NULL) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler create: xEventGroupCreate failed");
+        goto __err;
+    }
+    sched->running = true;
+
+    jitter_buffer_priv_task_create(jitter_buffer_scheduler_task, "jitter_sched_task", sched, config->task_stack,
+                                   config->task_prio, config->task_core, config->task_stack_caps, &sched->task_handle,
+                                   &sched->task_with_caps);
+    if (sched->task_handle == NULL) {
+        ESP_LOGE(TAG, "Create jitter buffer scheduler task failed");
+        goto __err;
+    }
+    return (jitter_buffer_scheduler_handle_t)sched;
+
+__err:
+    if (sched->event_group != NULL) {
+        vEventGroupDelete(sched->event_group);
+    }
+    if (sched->mutex != NULL) {
+        vSemaphoreDelete(sched->mutex);
+    }
+    free(sched->streams);
+    free(sched->gains);
+    free(sched->mix);
+    free(sched->scratch);
+    free(sched);
+    return NULL;
+}
+
+esp_err_t jitter_buffer_scheduler_destroy(jitter_buffer_scheduler_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)handle;
+    xSemaphoreTake(sched->mutex, portMAX_DELAY);
+    uint32_t stream_count = sched->stream_count;
+    xSemaphoreGive(sched->mutex);
+    if (stream_count > 0) {
+        ESP_LOGW(TAG, "Jitter buffer scheduler destroy: %lu jitter buffer(s) still attached", (unsigned long)stream_count);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    atomic_store(&sched->running, false);
+    xEventGroupWaitBits(sched->event_group, JITTER_SCHEDULER_EVENT_EXITED, pdFALSE, pdFALSE,
+                        pdMS_TO_TICKS(sched->config.frame_interval + 500));
+    jitter_buffer_priv_task_delete(sched->task_handle, sched->task_with_caps);
+
+    vEventGroupDelete(sched->event_group);
+    vSemaphoreDelete(sched->mutex);
+    free(sched->streams);
+    free(sched->gains);
+    free(sched->mix);
+    free(sched->scratch);
+    free(sched);
+    return ESP_OK;
+}
+
+esp_err_t jitter_buffer_scheduler_add(jitter_buffer_scheduler_handle_t handle, jitter_buffer_handle_t jb,
+                                      const jitter_buffer_config_t *config)
+{
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)handle;
+    if (config->frame_interval != sched->config.frame_interval) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler add: frame_interval=%lu, scheduler runs at %lu",
+                 (unsigned long)config->frame_interval, (unsigned long)sched->config.frame_interval);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sched->mix != NULL && (config->audio_format_id != AUDIO_FORMAT_ID_PCM || config->with_header ||
+                               config->frame_size != sched->config.mix_frame_size)) {
+        ESP_LOGE(TAG, "Jitter buffer scheduler add: mixer needs PCM without header and frame_size=%lu",
+                 (unsigned long)sched->config.mix_frame_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(sched->mutex, portMAX_DELAY);
+    if (sched->stream_count >= sched->config.max_streams) {
+        xSemaphoreGive(sched->mutex);
+        ESP_LOGE(TAG, "Jitter buffer scheduler add: max_streams(%lu) reached", (unsigned long)sched->config.max_streams);
+        return ESP_ERR_NO_MEM;
+    }
+    if (sched->gains != NULL) {
+        sched->gains[sched->stream_count] = JITTER_MIX_GAIN_UNITY;
+    }
+    sched->streams[sched->stream_count++] = jb;
+    xSemaphoreGive(sched->mutex);
+    return ESP_OK;
+}
+
+void jitter_buffer_scheduler_remove(jitter_buffer_scheduler_handle_t handle, jitter_buffer_handle_t jb)
+{
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)handle;
+    xSemaphoreTake(sched->mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < sched->stream_count; i++) {
+        if (sched->streams[i] == jb) {
+            /* 保持其余实例的输出顺序 */
+            memmove(&sched->streams[i], &sched->streams[i + 1], (sched->stream_count - i - 1) * sizeof(jitter_buffer_handle_t));
+            if (sched->gains != NULL) {
+                memmove(&sched->gains[i], &sched->gains[i + 1], (sched->stream_count - i - 1) * sizeof(uint32_t));
+            }
+            sched->stream_count--;
+            break;
+        }
+    }
+    xSemaphoreGive(sched->mutex);
+}
+
+void jitter_buffer_scheduler_sync(jitter_buffer_scheduler_handle_t handle)
+{
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)handle;
+    if (xTaskGetCurrentTaskHandle() == sched->task_handle) {
+        return;
+    }
+    xSemaphoreTake(sched->mutex, portMAX_DELAY);
+    xSemaphoreGive(sched->mutex);
+}
+
+bool jitter_buffer_scheduler_mixing(jitter_buffer_scheduler_handle_t handle)
+{
+    return ((jitter_buffer_scheduler_t *)handle)->config.mix_frame_size > 0;
+}
+
+esp_err_t jitter_buffer_scheduler_set_gain(jitter_buffer_scheduler_handle_t handle, jitter_buffer_handle_t stream,
+                                           uint32_t gain_q12)
+{
+    if (handle == NULL || stream == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jitter_buffer_scheduler_t *sched = (jitter_buffer_scheduler_t *)handle;
+    if (sched->gains == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (gain_q12 > JITTER_MIX_GAIN_MAX) {
+        gain_q12 = JITTER_MIX_GAIN_MAX;
+    }
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(sched->mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < sched->stream_count; i++) {
+        if (sched->streams[i] == stream) {
+            sched->gains[i] = gain_q12;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    xSemaphoreGive(sched->mutex);
+    return ret;
+}